@@ -0,0 +1,285 @@
+// I2C throughput and latency of the PCA9685 write paths.
+//
+//   I2C_Benchmark [--device /dev/i2c-1] [--address 0x40[,0x41,...]] [--seconds 2] [--emulate [bus_hz]]
+//
+// --emulate runs against the in-process PCA9685 emulator instead of the bus,
+// charging the wire time of a bus_hz clock (default 400 kHz, 0 = software only).
+// On real hardware every channel is driven around 1.5 ms: unplug the servos or
+// expect them to centre.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <memory>
+#include <string>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../Libraries/PCA9685/PCA9685.h"
+#include "../Libraries/PCA9685/I2CTransaction.h"
+#include "../Libraries/PCA9685/I2CUring.h"
+#include "../Libraries/PCA9685/PCA9685Emulator.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t CENTRE_TICKS = 307;     // ~1.5 ms at 50 Hz
+constexpr uint8_t LED0_ON_L = 0x06;
+
+struct Options {
+    std::string device = "/dev/i2c-1";
+    std::vector<uint8_t> addresses = {0x40};
+    double seconds = 2.0;
+    bool emulate = false;
+    uint32_t busHz = 400000;
+};
+
+struct Traffic {
+    uint64_t ops = 0;
+    uint64_t transactions = 0;
+    uint64_t bytes = 0;         // Payload bytes on the wire, address bytes not counted
+    uint64_t channels = 0;      // Servo channel updates carried
+    uint64_t failures = 0;
+};
+
+void usage(const char *argv0) {
+    std::fprintf(stderr, "Usage: %s [--device PATH] [--address 0x40[,0x41...]] [--seconds N] [--emulate [BUS_HZ]]\n", argv0);
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+
+        if (!std::strcmp(arg, "--device") && hasValue) {
+            opt.device = argv[++i];
+        } else if (!std::strcmp(arg, "--address") && hasValue) {
+            opt.addresses.clear();
+            for (char *tok = std::strtok(argv[++i], ","); tok; tok = std::strtok(nullptr, ",")) {
+                opt.addresses.push_back(static_cast<uint8_t>(std::strtoul(tok, nullptr, 0)));
+            }
+        } else if (!std::strcmp(arg, "--seconds") && hasValue) {
+            opt.seconds = std::atof(argv[++i]);
+        } else if (!std::strcmp(arg, "--emulate")) {
+            opt.emulate = true;
+            if (hasValue) {
+                opt.busHz = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+            }
+        } else {
+            return false;
+        }
+    }
+    return !opt.addresses.empty() && opt.seconds > 0.0;
+}
+
+void report(const char *name, const Traffic &t, double seconds, const LatencyHistogram &latency) {
+    std::printf("%-18s %10.0f %10.0f %12.0f %12.0f %8lld %8lld %8lld %8lld %6llu\n", name,
+                t.ops / seconds, t.transactions / seconds, t.bytes / seconds, t.channels / seconds,
+                static_cast<long long>(latency.percentile(50).count()),
+                static_cast<long long>(latency.percentile(90).count()),
+                static_cast<long long>(latency.percentile(99).count()),
+                static_cast<long long>(latency.max().count()),
+                static_cast<unsigned long long>(t.failures));
+}
+
+// Repeats op for the configured time, op reports the traffic it generated
+template <typename Op>
+void bench(const char *name, double seconds, Op op) {
+    LatencyHistogram latency;
+    Traffic traffic;
+    const auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    const auto start = Clock::now();
+
+    for (uint64_t i = 0; Clock::now() < end; i++) {
+        op(i, traffic, latency);
+        traffic.ops++;
+    }
+
+    report(name, traffic, std::chrono::duration<double>(Clock::now() - start).count(), latency);
+}
+
+// Alternate between two neighbouring values so the register shadow never skips a write
+uint16_t ticksFor(uint64_t i, uint8_t channel) {
+    return static_cast<uint16_t>(CENTRE_TICKS + ((i + channel) & 1));
+}
+
+void packChannels(uint64_t i, uint8_t first, uint8_t count, uint8_t *data) {
+    for (uint8_t k = 0; k < count; k++) {
+        const uint16_t off = ticksFor(i, first + k);
+        data[4 * k + 0] = 0;
+        data[4 * k + 1] = 0;
+        data[4 * k + 2] = static_cast<uint8_t>(off & 0xFF);
+        data[4 * k + 3] = static_cast<uint8_t>(off >> 8);
+    }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<PCA9685Emulator> emulator;
+    if (opt.emulate) {
+        emulator = std::make_unique<PCA9685Emulator>(opt.busHz);
+        for (uint8_t address : opt.addresses) {
+            emulator->addDevice(address);
+        }
+    }
+
+    std::vector<std::unique_ptr<PCA9685>> boards;
+    for (uint8_t address : opt.addresses) {
+        auto board = std::make_unique<PCA9685>(address, opt.device, NOMINAL_PWM_FREQ_HZ);
+        board->setBackend(emulator.get());
+        if (!board->open()) {
+            std::fprintf(stderr, "Failed to open PCA9685 0x%02x on %s\n", address, opt.device.c_str());
+            return 1;
+        }
+        boards.push_back(std::move(board));
+    }
+    PCA9685 &pwm = *boards.front();
+
+    std::printf("%s, %zu board(s), %.1f s per mode\n",
+                opt.emulate ? (opt.busHz ? "Emulated bus" : "Emulator, no wire time") : opt.device.c_str(),
+                boards.size(), opt.seconds);
+    std::printf("%-18s %10s %10s %12s %12s %8s %8s %8s %8s %6s\n", "mode", "ops/s", "txn/s", "bytes/s",
+                "servo upd/s", "p50 us", "p90 us", "p99 us", "max us", "fail");
+
+    // One channel, one 4-byte register write per transaction
+    bench("setPWM", opt.seconds, [&](uint64_t i, Traffic &t, LatencyHistogram &lat) {
+        const auto t0 = Clock::now();
+        const bool ok = pwm.setPWM(0, 0, ticksFor(i, 0));
+        lat.record(Clock::now() - t0);
+        t.transactions++;
+        t.bytes += 5;
+        t.channels += ok;
+        t.failures += !ok;
+    });
+
+    // setPWM x16, one per transaction
+    bench("setPWM x16", opt.seconds, [&](uint64_t i, Traffic &t, LatencyHistogram &lat) {
+        for (uint8_t ch = 0; ch < 16; ch++) {
+            const auto t0 = Clock::now();
+            const bool ok = pwm.setPWM(ch, 0, ticksFor(i, ch));
+            lat.record(Clock::now() - t0);
+            t.transactions++;
+            t.bytes += 5;
+            t.channels += ok;
+            t.failures += !ok;
+        }
+    });
+
+    // All 16 channels staged and sent as one auto-increment burst
+    bench("burst x16", opt.seconds, [&](uint64_t i, Traffic &t, LatencyHistogram &lat) {
+        const auto t0 = Clock::now();
+        pwm.beginUpdate();
+        for (uint8_t ch = 0; ch < 16; ch++) {
+            pwm.setPWM(ch, 0, ticksFor(i, ch));
+        }
+        const bool ok = pwm.commitUpdate();
+        lat.record(Clock::now() - t0);
+        t.transactions++;
+        t.bytes += 1 + 64;
+        t.channels += ok ? 16 : 0;
+        t.failures += !ok;
+    });
+
+    // Four 4-channel writes as one I2C_RDWR (repeated START, one STOP), e.g. non-adjacent groups
+    int fd = -1;
+    if (!opt.emulate) {
+        fd = ::open(opt.device.c_str(), O_RDWR);
+    }
+    bench("combined 4x4", opt.seconds, [&](uint64_t i, Traffic &t, LatencyHistogram &lat) {
+        I2CTransaction txn(opt.addresses.front());
+        for (uint8_t group = 0; group < 4; group++) {
+            uint8_t data[16];
+            packChannels(i, 4 * group, 4, data);
+            txn.write(LED0_ON_L + 16 * group, data, sizeof(data));
+        }
+
+        const auto t0 = Clock::now();
+        const bool ok = emulator ? txn.submit(*emulator) : txn.submit(fd);
+        lat.record(Clock::now() - t0);
+        t.transactions++;
+        t.bytes += txn.byteCount();
+        t.channels += ok ? 16 : 0;
+        t.failures += !ok;
+    });
+    if (fd >= 0) {
+        ::close(fd);
+    }
+
+    // One burst per board, every board on the bus in turn
+    if (boards.size() > 1) {
+        bench("multi-address", opt.seconds, [&](uint64_t i, Traffic &t, LatencyHistogram &lat) {
+            for (auto &board : boards) {
+                const auto t0 = Clock::now();
+                board->beginUpdate();
+                for (uint8_t ch = 0; ch < 16; ch++) {
+                    board->setPWM(ch, 0, ticksFor(i, ch));
+                }
+                const bool ok = board->commitUpdate();
+                lat.record(Clock::now() - t0);
+                t.transactions++;
+                t.bytes += 1 + 64;
+                t.channels += ok ? 16 : 0;
+                t.failures += !ok;
+            }
+        });
+    }
+
+    // Every board's burst queued on io_uring, one io_uring_enter per round. Latency is the
+    // submitting thread's cost; the round trip is included by draining every 64 rounds
+    I2CUring ring;
+    if (!opt.emulate && ring.init()) {
+        for (auto &board : boards) {
+            board->setTransport(&ring);
+        }
+        bench("io_uring burst", opt.seconds, [&](uint64_t i, Traffic &t, LatencyHistogram &lat) {
+            const auto t0 = Clock::now();
+            ring.beginBatch();
+            for (auto &board : boards) {
+                board->beginUpdate();
+                for (uint8_t ch = 0; ch < 16; ch++) {
+                    board->setPWM(ch, 0, ticksFor(i, ch));
+                }
+                t.failures += !board->commitUpdate();
+                t.transactions++;
+                t.bytes += 1 + 64;
+                t.channels += 16;
+            }
+            t.failures += !ring.endBatch();
+            if ((i & 63) == 63) {
+                ring.drain();
+            }
+            lat.record(Clock::now() - t0);
+        });
+        ring.drain();
+
+        const UringStats async = ring.getStats();
+        std::printf("io_uring: %llu writes in %llu submits, %llu failed, %llu cancelled, %llu skipped\n",
+                    static_cast<unsigned long long>(async.writes), static_cast<unsigned long long>(async.submits),
+                    static_cast<unsigned long long>(async.failed), static_cast<unsigned long long>(async.cancelled),
+                    static_cast<unsigned long long>(async.skipped));
+        for (auto &board : boards) {
+            board->setTransport(nullptr);
+        }
+    }
+
+    // Driver-side view of the same run, retries and errors included
+    for (auto &board : boards) {
+        const BusStats bus = board->getBusStats();
+        std::printf("driver: %llu transactions, %llu bytes, %llu errors, %llu retries, %llu failures\n",
+                    static_cast<unsigned long long>(bus.transactions), static_cast<unsigned long long>(bus.bytes),
+                    static_cast<unsigned long long>(bus.errors), static_cast<unsigned long long>(bus.retries),
+                    static_cast<unsigned long long>(bus.failures));
+        board->allOff();
+    }
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include "Control_Link.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <new>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../Output_Scheduler/Output_Scheduler.h"
+#include "../Periodic_Loop/Periodic_Loop.h"
+
+void collectStatus(const StatusSources &sources, ControlStatus &status) {
+    status.publishedNs = ControlLink::clockNs();
+    status.controlPid = static_cast<int32_t>(getpid());
+    status.flags = 0;
+
+    if (sources.telemetry) {
+        status.telemetry = sources.telemetry->load();
+    }
+
+    if (sources.pwm) {
+        const LatencyHistogram &latency = sources.pwm->busLatency();
+        status.bus = sources.pwm->getBusStats();
+        status.writes = sources.pwm->getOutputStats();
+        status.busP50Us = latency.percentile(50).count();
+        status.busP99Us = latency.percentile(99).count();
+        status.busMaxUs = latency.max().count();
+        if (sources.pwm->emergencyStopped()) {
+            status.flags |= STATUS_ESTOPPED;
+        }
+    }
+
+    if (sources.ring && sources.ring->available()) {
+        status.async = sources.ring->getStats();
+        status.flags |= STATUS_ASYNC;
+    }
+
+    if (sources.output) {
+        status.frames = sources.output->frames();
+        status.missedFrames = sources.output->missedFrames();
+    }
+    if (sources.inputLoop) {
+        status.inputTicks = sources.inputLoop->ticks();
+        status.inputWorkP99Us = sources.inputLoop->compute().percentile(99).count();
+    }
+    if (sources.ikLoop) {
+        status.ikTicks = sources.ikLoop->ticks();
+        status.ikOverruns = sources.ikLoop->overruns();
+        status.ikLateP99Us = sources.ikLoop->lateness().percentile(99).count();
+        status.ikWorkP99Us = sources.ikLoop->compute().percentile(99).count();
+    }
+    if (sources.poseAge) {
+        status.poseAgeP99Us = sources.poseAge->percentile(99).count();
+    }
+
+    const LatencyHistogram *latencies[STATUS_LATENCIES] = {
+        sources.ikLoop ? &sources.ikLoop->period() : nullptr,
+        sources.ikSolve,
+        sources.output ? &sources.output->updateTime() : nullptr,
+        sources.output ? &sources.output->targetAge() : nullptr,
+    };
+    for (size_t i = 0; i < STATUS_LATENCIES; i++) {
+        if (latencies[i]) {
+            status.latency[i] = latencies[i]->snapshot();
+            status.latencyMaxUs[i] = latencies[i]->max().count();
+        }
+    }
+
+    if (sources.ikPerf) {
+        status.perfTicks = sources.ikPerf->count();
+        for (size_t i = 0; i < PERF_COUNTERS; i++) {
+            status.perfTotals[i] = sources.ikPerf->total(static_cast<PerfCounter>(i));
+        }
+    }
+}
+
+int64_t ControlLink::clockNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+ControlLink::ControlLink(std::string name) : name_(std::move(name)), region_(nullptr), owner_(false), lockFd_(-1) {}
+
+ControlLink::~ControlLink() {
+    close();
+}
+
+bool ControlLink::create() {
+    if (region_) {
+        return owner_;
+    }
+
+    // Ownership is the exclusive flock on the object, held until close() (or exit): taken
+    // before anything is resized or reset, so a running control process is never touched
+    int fd = -1;
+    for (int attempt = 0; fd < 0; attempt++) {
+        fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+        if (fd < 0) {
+            return false;
+        }
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            const int err = errno;
+            ::close(fd);
+            errno = err == EWOULDBLOCK ? EBUSY : err;
+            return false;
+        }
+
+        // The previous owner unlinks before it lets go of the lock: only the object
+        // still behind the name counts
+        if (!lockedCurrent(fd)) {
+            ::close(fd);
+            fd = -1;
+            if (attempt >= CREATE_ATTEMPTS) {
+                errno = EBUSY;
+                return false;
+            }
+        }
+    }
+
+    if (ftruncate(fd, sizeof(Region)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    // Left behind by a control process that died: start over
+    auto *existing = static_cast<Region *>(map);
+    existing->magic.store(0, std::memory_order_release);
+    region_ = new (map) Region();
+    region_->version = CONTROL_LINK_VERSION;
+    region_->size = sizeof(Region);
+    region_->ownerPid.store(getpid(), std::memory_order_relaxed);
+    region_->magic.store(CONTROL_LINK_MAGIC, std::memory_order_release);
+    lockFd_ = fd;
+    owner_ = true;
+    return true;
+}
+
+bool ControlLink::lockedCurrent(int fd) const {
+    const int current = shm_open(name_.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (current < 0) {
+        return false;
+    }
+    struct stat locked;
+    struct stat named;
+    const bool same = fstat(fd, &locked) == 0 && fstat(current, &named) == 0 && locked.st_dev == named.st_dev &&
+                      locked.st_ino == named.st_ino;
+    ::close(current);
+    return same;
+}
+
+bool ControlLink::attach() {
+    if (region_) {
+        return true;
+    }
+
+    const int fd = shm_open(name_.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Region)) {
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    auto *region = static_cast<Region *>(map);
+    if (region->magic.load(std::memory_order_acquire) != CONTROL_LINK_MAGIC ||
+        region->version != CONTROL_LINK_VERSION || region->size != sizeof(Region)) {
+        munmap(map, sizeof(Region));
+        return false;
+    }
+
+    region_ = region;
+    owner_ = false;
+    return true;
+}
+
+void ControlLink::close() {
+    if (!region_) {
+        return;
+    }
+
+    // Attached UIs see the magic drop and go back to waiting for a control process.
+    // Unlinked before the lock goes, so the next owner starts from a fresh object
+    if (owner_) {
+        region_->magic.store(0, std::memory_order_release);
+        shm_unlink(name_.c_str());
+        ::close(lockFd_);
+        lockFd_ = -1;
+    }
+    munmap(region_, sizeof(Region));
+    region_ = nullptr;
+    owner_ = false;
+}
+
+void ControlLink::publish(const ControlStatus &status) {
+    if (region_ && owner_) {
+        region_->status.store(status);
+    }
+}
+
+bool ControlLink::receive(ControlCommand &command) {
+    return region_ && owner_ && region_->commands.pop(command);
+}
+
+bool ControlLink::load(ControlStatus &status) const {
+    if (!region_ || region_->magic.load(std::memory_order_acquire) != CONTROL_LINK_MAGIC ||
+        region_->status.version() == 0) {
+        return false;
+    }
+    return region_->status.tryLoad(status, LOAD_ATTEMPTS);
+}
+
+bool ControlLink::send(ControlCommandType type) {
+    if (!region_ || region_->magic.load(std::memory_order_acquire) != CONTROL_LINK_MAGIC) {
+        return false;
+    }
+    return region_->commands.push({type, static_cast<int32_t>(getpid())});
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+#include "../Histogram/Histogram.h"
+#include "../Mpsc_Queue/Mpsc_Queue.h"
+#include "../PCA9685/PCA9685.h"
+#include "../PCA9685/I2CUring.h"
+#include "../Perf_Counters/Perf_Counters.h"
+#include "../Seqlock/Seqlock.h"
+
+class OutputScheduler;
+class PeriodicLoop;
+
+constexpr const char *CONTROL_LINK_NAME = "/6dof_control";     // /dev/shm/6dof_control
+constexpr uint32_t CONTROL_LINK_MAGIC = 0x4C525443;              // "CTRL"
+constexpr uint16_t CONTROL_LINK_VERSION = 1;
+
+// Pose and commanded angles, published once per IK tick
+struct Telemetry {
+    float x = 0.0f, y = 0.0f, z = 0.3f, roll = 0.0f, pitch = 0.0f, yaw = 0.0f;
+    float x_delta = 0.0f, y_delta = 0.0f, z_delta = 0.0f, roll_delta = 0.0f, pitch_delta = 0.0f, yaw_delta = 0.0f;
+    float angle[6] = {};
+};
+
+// Latency table rows
+enum StatusLatency : size_t {
+    LATENCY_TICK_PERIOD,
+    LATENCY_IK_SOLVE,
+    LATENCY_ACTUATION,
+    LATENCY_INPUT_TO_SERVO,
+    STATUS_LATENCIES
+};
+
+constexpr uint32_t STATUS_ESTOPPED = 1u << 0;
+constexpr uint32_t STATUS_ASYNC = 1u << 1;      // io_uring transport in use
+
+// Everything a dashboard shows, copied out of the control process in one go.
+// Plain values only, so it can cross into another process as is
+struct ControlStatus {
+    int64_t publishedNs;    // CLOCK_MONOTONIC, comparable between processes
+    int32_t controlPid;
+    uint32_t flags;         // STATUS_* bits
+
+    Telemetry telemetry;
+    BusStats bus;
+    OutputStats writes;
+    UringStats async;
+    int64_t busP50Us, busP99Us, busMaxUs;
+
+    uint64_t frames, missedFrames;
+    uint64_t inputTicks, ikTicks, ikOverruns;
+    int64_t inputWorkP99Us, ikLateP99Us, ikWorkP99Us, poseAgeP99Us;
+
+    LatencyHistogram::Snapshot latency[STATUS_LATENCIES];
+    int64_t latencyMaxUs[STATUS_LATENCIES];
+
+    uint64_t perfTicks;                     // IK ticks the counters cover, 0 without counters
+    uint64_t perfTotals[PERF_COUNTERS];
+};
+
+// Where the control process takes a status snapshot from
+struct StatusSources {
+    const Seqlock<Telemetry> *telemetry;
+    const PCA9685 *pwm;
+    const OutputScheduler *output;
+    const PeriodicLoop *inputLoop;
+    const PeriodicLoop *ikLoop;
+    const LatencyHistogram *poseAge;
+    const LatencyHistogram *ikSolve;
+    const PerfStage *ikPerf;
+    const I2CUring *ring;
+};
+
+void collectStatus(const StatusSources &sources, ControlStatus &status);
+
+enum class ControlCommandType : uint32_t {
+    EmergencyStop,
+    Shutdown,       // Same as SIGTERM
+    TraceCapture,   // Same as SIGUSR1
+};
+
+struct ControlCommand {
+    ControlCommandType type;
+    int32_t senderPid;
+};
+
+// Shared-memory link between the control process and any number of UI
+// processes. The control side publishes a ControlStatus snapshot (seqlock, it
+// never waits on readers) and drains operator commands from a lock-free queue.
+// A UI that hangs or dies can't hold up the control loop
+class ControlLink {
+public:
+    explicit ControlLink(std::string name = CONTROL_LINK_NAME);
+    ~ControlLink();
+
+    bool create();  // Control process. errno EBUSY: another control process holds the region's lock
+    bool attach();  // UI process, false until a control process has created the region
+    void close();
+    bool isOpen() const { return region_ != nullptr; }
+
+    // Control side
+    void publish(const ControlStatus &status);
+    bool receive(ControlCommand &command);
+
+    // UI side. load() is false until the first snapshot, once the control process exits, and
+    // if it died in the middle of publishing (never blocks on the other process)
+    bool load(ControlStatus &status) const;
+    bool send(ControlCommandType type);
+
+    // Clock behind ControlStatus::publishedNs
+    static int64_t clockNs();
+
+private:
+    static constexpr size_t COMMAND_SLOTS = 64;
+    static constexpr int LOAD_ATTEMPTS = 64;    // A store takes microseconds, more means the writer died in one
+    static constexpr int CREATE_ATTEMPTS = 8;   // Lost races against owners handing over
+
+    struct Region {
+        std::atomic<uint32_t> magic;    // Set last, a region being set up is never used
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t size;                  // sizeof(Region), guards against a mismatched build
+        std::atomic<int32_t> ownerPid;  // Control process that created it, informational: the flock decides
+        Seqlock<ControlStatus> status;
+        MpscQueue<ControlCommand, COMMAND_SLOTS> commands;
+    };
+
+    bool lockedCurrent(int fd) const;
+
+    std::string name_;
+    Region *region_;
+    bool owner_;
+    int lockFd_;    // Owner only: the shm fd holding the exclusive flock
+};
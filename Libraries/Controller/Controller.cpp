@@ -1,5 +1,6 @@
 #include "Controller.h"
 #include "../Utilities/Utilities.h"
+#include "../Trace/Trace.h"
 
 #include <cstdint>
 #include <string>
@@ -37,6 +38,7 @@ namespace {
     int16_t RT_VALUE   = 0;
     float   BMP_VALUE  = 0;
     std::atomic<bool> PROGRAMSTATE{true}; 
+    uint32_t STOP_TIMESTAMP = 0;    // SDL ticks (ms) when 'minus' was pressed
 }
 
 Controller::Controller() = default;
@@ -144,6 +146,7 @@ void Controller::handleJoyButtons(SDL_Event e) {
             BMP_VALUE += 0.14;
             break;
         case MIN:
+            STOP_TIMESTAMP = e.common.timestamp;
             PROGRAMSTATE.store(false);
             break;
         case PLU:
@@ -153,6 +156,7 @@ void Controller::handleJoyButtons(SDL_Event e) {
 
 
 void Controller::updateAxes() {
+    TRACE_SCOPE("updateAxes");
     if (!joystick_) {
         return;
     }
@@ -224,6 +228,10 @@ bool Controller::getProgramState() {
     return PROGRAMSTATE.load();
 }
 
+uint32_t Controller::getStopTimestamp() {
+    return STOP_TIMESTAMP;
+}
+
 float Controller::getBMPValue() {
     return BMP_VALUE;
 }
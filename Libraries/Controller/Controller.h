@@ -27,6 +27,7 @@ public:
     int16_t getLT();
     int16_t getRT();
     bool getProgramState();
+    uint32_t getStopTimestamp();
     float getBMPValue();
     float getLSAngle();
     float getRSAngle();
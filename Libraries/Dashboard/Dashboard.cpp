@@ -0,0 +1,406 @@
+#include "Dashboard.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#include <ftxui/dom/node.hpp>
+#include <ftxui/dom/table.hpp>
+#include <ftxui/screen/screen.hpp>
+
+
+namespace {
+constexpr size_t CELL_CHARS = 48;   // Reserved per cell, formatting never grows past it
+
+// Health table rows, in display order
+enum HealthRow : size_t {
+    TRANSACTIONS = 1, BYTES, ERRORS, RETRIES, FAILURES, LATENCY_P50, LATENCY_P99, LATENCY_MAX, MISSED_FRAMES,
+    INPUT_WORK, IK_LATE, IK_WORK, IK_OVERRUNS, IK_IPC, IK_CACHE_MISSES, POSE_AGE, SUPPRESSED,
+    ASYNC_WRITES, ASYNC_FAILED, ASYNC_SKIPPED, IN_FLIGHT, BUS_ERRNO, HEALTH_ROWS
+};
+
+const char *const HEALTH_LABELS[HEALTH_ROWS] = {
+    "Bus", "Transactions", "Bytes", "Errors", "Retries", "Failures", "Latency p50", "Latency p99", "Latency max",
+    "Missed frames", "Input work p99", "IK late p99", "IK work p99", "IK overruns", "IK IPC", "IK cache misses",
+    "Pose age p99", "Suppressed", "Async writes", "Async failed", "Async skipped", "In flight", "Errno",
+};
+
+// Latency table rows: what a "feels laggy" report usually comes down to
+const char *const LATENCY_LABELS[] = {"Tick period", "IK solve", "Actuation", "Input->servo"};
+const char *const SPARK_LEVELS[] = {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+constexpr size_t SPARK_CHARS = 3;       // UTF-8 bytes per level glyph
+
+const char *const POSE_LABELS[] = {"x", "y", "z", "roll", "pitch", "yaw"};
+const char *const SERVO_LABELS[] = {"MS62_1", "MS62_2", "DM996_1", "DM996_2", "DM996_3", "DM996_4"};
+
+// Appends to a fixed buffer, cutting off whatever doesn't fit
+class LineWriter {
+public:
+    LineWriter(char *buf, size_t len) : begin_(buf), pos_(buf), end_(buf + len) {}
+
+    LineWriter &operator<<(const char *str) {
+        const size_t len = std::min(std::strlen(str), static_cast<size_t>(end_ - pos_));
+        std::memcpy(pos_, str, len);
+        pos_ += len;
+        return *this;
+    }
+    LineWriter &operator<<(uint64_t value) {
+        auto result = std::to_chars(pos_, end_, value);
+        if (result.ec == std::errc()) {
+            pos_ = result.ptr;
+        }
+        return *this;
+    }
+    LineWriter &operator<<(std::chrono::microseconds us) {
+        return *this << static_cast<uint64_t>(us.count()) << " us";
+    }
+    LineWriter &fixed(double value, int precision) {
+        auto result = std::to_chars(pos_, end_, value, std::chars_format::fixed, precision);
+        if (result.ec == std::errc()) {
+            pos_ = result.ptr;
+        }
+        return *this;
+    }
+    LineWriter &rate(double hz) {
+        return fixed(hz, 1) << " Hz";
+    }
+
+    const char *begin() const { return begin_; }
+    const char *end() const { return pos_; }
+    size_t size() const { return static_cast<size_t>(pos_ - begin_); }
+
+private:
+    char *begin_;
+    char *pos_;
+    char *end_;
+};
+
+void setCell(std::string &cell, const char *begin, const char *end) {
+    cell.assign(begin, static_cast<size_t>(end - begin));   // Fits the reserved capacity, no allocation
+}
+
+void setCell(std::string &cell, double value, int precision = 6, const char *suffix = "") {
+    char buf[CELL_CHARS];
+    LineWriter line(buf, sizeof(buf));
+    line.fixed(value, precision) << suffix;
+    setCell(cell, line.begin(), line.end());
+}
+
+void setCell(std::string &cell, uint64_t value, const char *suffix = "") {
+    char buf[CELL_CHARS];
+    LineWriter line(buf, sizeof(buf));
+    line << value << suffix;
+    setCell(cell, line.begin(), line.end());
+}
+
+void setCell(std::string &cell, std::chrono::microseconds us) {
+    char buf[CELL_CHARS];
+    LineWriter line(buf, sizeof(buf));
+    line << us;
+    setCell(cell, line.begin(), line.end());
+}
+
+// Percentiles published as plain microsecond counts
+void setMicros(std::string &cell, int64_t us) {
+    setCell(cell, std::chrono::microseconds(us));
+}
+
+// Ticks per second between two reads of a counter
+double rateOf(uint64_t now, uint64_t before, double seconds) {
+    return seconds > 0.0 ? static_cast<double>(now - before) / seconds : 0.0;
+}
+
+void setMissing(std::string &cell) {
+    cell.assign("-");
+}
+
+std::vector<std::vector<std::string>> makeRows(size_t rows, size_t columns) {
+    std::vector<std::vector<std::string>> table(rows, std::vector<std::string>(columns));
+    for (auto &row : table) {
+        for (auto &cell : row) {
+            cell.reserve(CELL_CHARS);
+        }
+    }
+    return table;
+}
+
+// Text node that reads its cell at render time: a table built once keeps showing whatever
+// refresh() last wrote into the strings. Cells are ASCII plus the sparkline glyphs, every
+// code point is one column wide
+class CellText : public ftxui::Node {
+public:
+    explicit CellText(const std::string &text) : text_(text) {}
+
+    void ComputeRequirement() override {
+        int columns = 0;
+        for (const char *p = text_.data(), *end = p + text_.size(); p < end; p += glyphBytes(p, end)) {
+            columns++;
+        }
+        requirement_.min_x = columns;
+        requirement_.min_y = 1;
+    }
+
+    void Render(ftxui::Screen &screen) override {
+        const int y = box_.y_min;
+        if (y > box_.y_max) {
+            return;
+        }
+        int x = box_.x_min;
+        for (const char *p = text_.data(), *end = p + text_.size(); p < end && x <= box_.x_max; x++) {
+            const size_t len = glyphBytes(p, end);
+            screen.PixelAt(x, y).character.assign(p, len);     // Fits the small-string buffer
+            p += len;
+        }
+    }
+
+private:
+    static size_t glyphBytes(const char *p, const char *end) {
+        const auto lead = static_cast<unsigned char>(*p);
+        const size_t len = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 1;
+        return std::min(len, static_cast<size_t>(end - p));
+    }
+
+    const std::string &text_;
+};
+
+// Built once over the row strings, which never move: their count is fixed at construction
+ftxui::Element styled(const std::vector<std::vector<std::string>> &rows) {
+    std::vector<std::vector<ftxui::Element>> cells;
+    for (const auto &row : rows) {
+        auto &line = cells.emplace_back();
+        for (const std::string &cell : row) {
+            line.push_back(std::make_shared<CellText>(cell));
+        }
+    }
+
+    ftxui::Table table(std::move(cells));
+    table.SelectRow(0).Decorate(ftxui::bold | ftxui::color(ftxui::Color::Cyan));    // Header row styling
+    table.SelectColumn(0).Decorate(ftxui::color(ftxui::Color::Yellow));            // Leftmost name column styling
+    table.SelectAll().Border(ftxui::LIGHT);                                         // Outer border around the table edges
+    table.SelectAll().Separator(ftxui::LIGHT);                                      // Vertical and horizontal inner dividers
+    return table.Render();
+}
+} // namespace
+
+Dashboard::Dashboard()
+    : pose_(makeRows(7, 3)), angles_(makeRows(7, 2)), health_(makeRows(HEALTH_ROWS, 2)),
+      latency_(makeRows(STATUS_LATENCIES + 1, 6)), lastTrendNs_(0), trendPid_(0), lastSummary_(std::chrono::steady_clock::now()), lastInputTicks_(0), lastIkTicks_(0), lastFrames_(0) {
+    pose_[0] = {"Name", "Value", "Delta"};
+    for (size_t i = 0; i < 6; i++) {
+        pose_[i + 1][0] = POSE_LABELS[i];
+    }
+
+    angles_[0] = {"Servo", "Angle"};
+    for (size_t i = 0; i < 6; i++) {
+        angles_[i + 1][0] = SERVO_LABELS[i];
+    }
+
+    health_[0] = {"Bus", "Value"};
+    for (size_t i = 1; i < HEALTH_ROWS; i++) {
+        health_[i][0] = HEALTH_LABELS[i];
+        setMissing(health_[i][1]);
+    }
+
+    latency_[0] = {"Latency", "p50", "p90", "p99", "max", "p99 trend"};
+    for (size_t i = 0; i < STATUS_LATENCIES; i++) {
+        latency_[i + 1][0] = LATENCY_LABELS[i];
+        latency_[i + 1][5].reserve(TREND_SAMPLES * SPARK_CHARS);
+        for (size_t col = 1; col < 5; col++) {
+            setMissing(latency_[i + 1][col]);
+        }
+        trends_[i] = {};
+    }
+
+    // Element tree for the whole view, render() hands out the same one every frame
+    using namespace ftxui;
+    view_ = vbox({
+        hbox({
+            styled(pose_),
+            separator(),
+            styled(angles_),
+            separator(),
+            styled(health_)
+        }) | center,
+        styled(latency_) | center
+    });
+}
+
+void Dashboard::refresh(const ControlStatus &status) {
+    // One consistent view of the last IK tick
+    const Telemetry &tel = status.telemetry;
+    const float values[6] = {tel.x, tel.y, tel.z, tel.roll, tel.pitch, tel.yaw};
+    const float deltas[6] = {tel.x_delta, tel.y_delta, tel.z_delta, tel.roll_delta, tel.pitch_delta, tel.yaw_delta};
+    for (size_t i = 0; i < 6; i++) {
+        setCell(pose_[i + 1][1], values[i]);
+        setCell(pose_[i + 1][2], deltas[i]);
+        setCell(angles_[i + 1][1], tel.angle[i]);
+    }
+
+    auto &h = health_;
+    const BusStats &bus = status.bus;
+    const OutputStats &writes = status.writes;
+    setCell(h[TRANSACTIONS][1], bus.transactions);
+    setCell(h[BYTES][1], bus.bytes);
+    setCell(h[ERRORS][1], bus.errors);
+    setCell(h[RETRIES][1], bus.retries);
+    setCell(h[FAILURES][1], bus.failures);
+    setMicros(h[LATENCY_P50][1], status.busP50Us);
+    setMicros(h[LATENCY_P99][1], status.busP99Us);
+    setMicros(h[LATENCY_MAX][1], status.busMaxUs);
+    setCell(h[SUPPRESSED][1], writes.hysteresisSkips + writes.shadowSkips);
+
+    // Only the errno classes seen so far, e.g. "EIO 3 ETIMEDOUT 1"
+    char buf[CELL_CHARS];
+    LineWriter line(buf, sizeof(buf));
+    for (size_t i = 0; i < BUS_ERRNO_SLOTS; i++) {
+        if (bus.errnoCounts[i] > 0) {
+            line << (line.size() > 0 ? " " : "") << PCA9685::busErrnoName(i) << " " << bus.errnoCounts[i];
+        }
+    }
+    if (line.size() == 0) {
+        h[BUS_ERRNO][1].assign("none");
+    } else {
+        setCell(h[BUS_ERRNO][1], line.begin(), line.end());
+    }
+
+    setCell(h[MISSED_FRAMES][1], status.missedFrames);
+    setMicros(h[INPUT_WORK][1], status.inputWorkP99Us);
+    setMicros(h[IK_LATE][1], status.ikLateP99Us);
+    setMicros(h[IK_WORK][1], status.ikWorkP99Us);
+    setCell(h[IK_OVERRUNS][1], status.ikOverruns);
+    setMicros(h[POSE_AGE][1], status.poseAgeP99Us);
+
+    // Counters the kernel refused stay at 0 and show as "-"
+    const uint64_t *perf = status.perfTotals;
+    if (status.perfTicks > 0 && perf[PERF_CYCLES] > 0) {
+        setCell(h[IK_IPC][1], static_cast<double>(perf[PERF_INSTRUCTIONS]) / perf[PERF_CYCLES], 2);
+    } else {
+        setMissing(h[IK_IPC][1]);
+    }
+    if (status.perfTicks > 0 && perf[PERF_CACHE_MISSES] > 0) {
+        setCell(h[IK_CACHE_MISSES][1], static_cast<double>(perf[PERF_CACHE_MISSES]) / status.perfTicks, 0, " /tick");
+    } else {
+        setMissing(h[IK_CACHE_MISSES][1]);
+    }
+
+    if (status.flags & STATUS_ASYNC) {
+        setCell(h[ASYNC_WRITES][1], status.async.writes);
+        setCell(h[ASYNC_FAILED][1], status.async.failed + status.async.cancelled);
+        setCell(h[ASYNC_SKIPPED][1], status.async.skipped);
+        setCell(h[IN_FLIGHT][1], status.async.inFlight);
+    } else {
+        setMissing(h[ASYNC_WRITES][1]);
+        setMissing(h[ASYNC_FAILED][1]);
+        setMissing(h[ASYNC_SKIPPED][1]);
+        setMissing(h[IN_FLIGHT][1]);
+    }
+
+    sampleTrends(status);
+    for (size_t i = 0; i < STATUS_LATENCIES; i++) {
+        auto &row = latency_[i + 1];
+        const LatencyHistogram::Snapshot &snapshot = status.latency[i];
+        const std::chrono::microseconds max(status.latencyMaxUs[i]);
+        if (snapshot.count == 0) {
+            for (size_t col = 1; col < row.size(); col++) {
+                setMissing(row[col]);
+            }
+            continue;
+        }
+        setCell(row[1], std::min(snapshot.percentile(50), max));
+        setCell(row[2], std::min(snapshot.percentile(90), max));
+        setCell(row[3], std::min(snapshot.percentile(99), max));
+        setCell(row[4], max);
+
+        // Sparkline, oldest second on the left, scaled to the largest p99 shown
+        const Trend &trend = trends_[i];
+        const uint64_t peak = *std::max_element(std::begin(trend.p99), std::end(trend.p99));
+        char spark[TREND_SAMPLES * SPARK_CHARS];
+        char *end = spark;
+        for (size_t n = 0; n < TREND_SAMPLES; n++) {
+            const uint64_t value = trend.p99[(trend.next + n) % TREND_SAMPLES];
+            if (value == 0 || peak == 0) {
+                *end++ = ' ';
+                continue;
+            }
+            const size_t level = static_cast<size_t>(value * 7 / peak);
+            std::memcpy(end, SPARK_LEVELS[level], SPARK_CHARS);
+            end += SPARK_CHARS;
+        }
+        setCell(row[5], spark, end);
+    }
+}
+
+void Dashboard::sampleTrends(const ControlStatus &status) {
+    // A restarted control process starts its histograms from zero
+    if (status.controlPid != trendPid_) {
+        for (Trend &trend : trends_) {
+            trend = {};
+        }
+        trendPid_ = status.controlPid;
+        lastTrendNs_ = 0;
+    }
+
+    // Paced by the control process clock, a UI that stalls doesn't squeeze seconds together
+    if (lastTrendNs_ != 0 && status.publishedNs - lastTrendNs_ < 1000000000) {
+        return;
+    }
+    const bool first = lastTrendNs_ == 0;
+    lastTrendNs_ = status.publishedNs;
+
+    for (size_t i = 0; i < STATUS_LATENCIES; i++) {
+        Trend &trend = trends_[i];
+        // The first sample only sets the baseline, the whole history isn't one second
+        if (!first) {
+            trend.p99[trend.next] = static_cast<uint64_t>((status.latency[i] - trend.last).percentile(99).count());
+            trend.next = (trend.next + 1) % TREND_SAMPLES;
+        }
+        trend.last = status.latency[i];
+    }
+}
+
+size_t Dashboard::summary(const ControlStatus &status, char *buf, size_t len) {
+    const auto now = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(now - lastSummary_).count();
+    lastSummary_ = now;
+
+    LineWriter line(buf, len);
+    line << "input ";
+    line.rate(rateOf(status.inputTicks, lastInputTicks_, seconds)) << " | ";
+    lastInputTicks_ = status.inputTicks;
+
+    line << "ik ";
+    line.rate(rateOf(status.ikTicks, lastIkTicks_, seconds));
+    line << " work p99 " << std::chrono::microseconds(status.ikWorkP99Us)
+         << " late p99 " << std::chrono::microseconds(status.ikLateP99Us)
+         << " overruns " << status.ikOverruns << " | ";
+    lastIkTicks_ = status.ikTicks;
+
+    const LatencyHistogram::Snapshot &targetAge = status.latency[LATENCY_INPUT_TO_SERVO];
+    line << "output ";
+    line.rate(rateOf(status.frames, lastFrames_, seconds));
+    line << " missed " << status.missedFrames
+         << " input->servo p99 "
+         << std::min(targetAge.percentile(99), std::chrono::microseconds(status.latencyMaxUs[LATENCY_INPUT_TO_SERVO]))
+         << " | ";
+    lastFrames_ = status.frames;
+
+    line << "i2c errors " << status.bus.errors << " retries " << status.bus.retries << " failures "
+         << status.bus.failures << " p99 " << std::chrono::microseconds(status.busP99Us);
+
+    if (status.perfTicks > 0) {
+        const uint64_t *perf = status.perfTotals;
+        const double ticks = static_cast<double>(status.perfTicks);
+        line << " | ik ipc ";
+        line.fixed(perf[PERF_CYCLES] ? static_cast<double>(perf[PERF_INSTRUCTIONS]) / perf[PERF_CYCLES] : 0.0, 2)
+            << " cache misses/tick ";
+        line.fixed(perf[PERF_CACHE_MISSES] / ticks, 0) << " ctx switches/tick ";
+        line.fixed(perf[PERF_CONTEXT_SWITCHES] / ticks, 3);
+    }
+    return line.size();
+}
+
+ftxui::Element Dashboard::render() const {
+    return view_;
+}
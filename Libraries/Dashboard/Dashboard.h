@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <ftxui/dom/elements.hpp>
+
+#include "../Control_Link/Control_Link.h"
+
+// Pose, servo, bus health and latency tables. The cell strings are allocated once and
+// refresh() rewrites them in place with std::to_chars; the FTXUI element tree is built
+// once over them and only laid out again per frame, so the cost per frame doesn't
+// depend on how fast the control loops run. Everything comes from a
+// ControlStatus, so the same view works in the control process and in a UI
+// process attached over the ControlLink.
+class Dashboard {
+public:
+    Dashboard();
+    Dashboard(const Dashboard &) = delete;              // The element tree points into the rows
+    Dashboard &operator=(const Dashboard &) = delete;
+
+    void refresh(const ControlStatus &status);
+    ftxui::Element render() const;
+
+    // One compact log line for headless runs: loop rates since the previous call,
+    // IK timing and bus errors. Returns its length, never more than len
+    size_t summary(const ControlStatus &status, char *buf, size_t len);
+
+private:
+    using Rows = std::vector<std::vector<std::string>>;
+
+    static constexpr size_t TREND_SAMPLES = 32;     // One p99 per second
+
+    // p99 history of one histogram, from the difference of per-second snapshots
+    struct Trend {
+        LatencyHistogram::Snapshot last;
+        uint64_t p99[TREND_SAMPLES];
+        size_t next;
+    };
+
+    void sampleTrends(const ControlStatus &status);
+
+    Rows pose_;
+    Rows angles_;
+    Rows health_;
+    Rows latency_;
+    ftxui::Element view_;
+    Trend trends_[STATUS_LATENCIES];
+    int64_t lastTrendNs_;       // publishedNs of the last sample, 0 before the first
+    int32_t trendPid_;          // Control process the trends belong to
+
+    std::chrono::steady_clock::time_point lastSummary_;
+    uint64_t lastInputTicks_;
+    uint64_t lastIkTicks_;
+    uint64_t lastFrames_;
+};
@@ -0,0 +1,119 @@
+#include "Histogram.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+constexpr uint64_t MAX_US = (uint64_t{1} << LatencyHistogram::RANGE_BITS) - 1;
+
+// Bucket holding the rank-th smallest value (1-based), BUCKETS if there are fewer values
+size_t rankBucket(const uint64_t *buckets, uint64_t rank) {
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return i;
+        }
+    }
+    return LatencyHistogram::BUCKETS;
+}
+
+uint64_t percentileRank(double p, uint64_t count) {
+    return static_cast<uint64_t>(std::clamp(p, 0.0, 100.0) / 100.0 * (count - 1)) + 1;
+}
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t us) {
+    us = std::min(us, MAX_US);
+    if (us < SUB_BUCKETS) {
+        return static_cast<size_t>(us);     // Exact below the first octave
+    }
+
+    // Octave from the top bit, linear step from the SUB_BITS below it
+    const int shift = std::bit_width(us) - 1 - SUB_BITS;
+    return (static_cast<size_t>(shift) + 1) * SUB_BUCKETS + static_cast<size_t>((us >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperUs(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    const int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    const uint64_t lower = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    const uint64_t us = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) / 1000 : 0;
+
+    buckets_[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (us > seen && !max_.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+std::chrono::microseconds LatencyHistogram::mean() const {
+    const uint64_t n = count();
+    return std::chrono::microseconds(n ? sum_.load(std::memory_order_relaxed) / n : 0);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snap;
+    snap.count = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        snap.buckets[i] = bucket(i);
+        snap.count += snap.buckets[i];      // Summed here so count matches the buckets read
+    }
+    return snap;
+}
+
+std::chrono::microseconds LatencyHistogram::percentile(double p) const {
+    const uint64_t n = count();
+    if (n == 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    uint64_t buckets[BUCKETS];
+    for (size_t i = 0; i < BUCKETS; i++) {
+        buckets[i] = bucket(i);
+    }
+    const size_t index = rankBucket(buckets, percentileRank(p, n));
+    const uint64_t max = max_.load(std::memory_order_relaxed);
+    return std::chrono::microseconds(index < BUCKETS ? std::min(bucketUpperUs(index), max) : max);
+}
+
+std::chrono::microseconds LatencyHistogram::Snapshot::percentile(double p) const {
+    if (count == 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    const size_t index = rankBucket(buckets, percentileRank(p, count));
+    return std::chrono::microseconds(bucketUpperUs(std::min(index, BUCKETS - 1)));
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Snapshot::operator-(const Snapshot &earlier) const {
+    Snapshot diff;
+    diff.count = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        diff.buckets[i] = buckets[i] - earlier.buckets[i];
+        diff.count += diff.buckets[i];
+    }
+    return diff;
+}
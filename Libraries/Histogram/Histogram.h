@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free latency histogram in microseconds, log-linear (HDR-style) buckets:
+// every power of two is split into SUB_BUCKETS linear steps, so any value is
+// within 1/SUB_BUCKETS (~3%) of its bucket bound from 1 us up to ~16 s.
+// record() is a couple of relaxed atomic adds, safe from any thread.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BITS;
+    static constexpr int RANGE_BITS = 24;                                   // Values saturate at 2^24 us
+    static constexpr size_t BUCKETS = SUB_BUCKETS * (RANGE_BITS - SUB_BITS + 1);
+
+    // Bucket counts at one point in time. The difference of two snapshots is
+    // the distribution of everything recorded in between
+    struct Snapshot {
+        uint64_t buckets[BUCKETS];
+        uint64_t count;
+
+        std::chrono::microseconds percentile(double p) const;
+        Snapshot operator-(const Snapshot &earlier) const;
+    };
+
+    LatencyHistogram();
+
+    void record(std::chrono::nanoseconds latency);
+    void reset();
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t bucket(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+    std::chrono::microseconds max() const { return std::chrono::microseconds(max_.load(std::memory_order_relaxed)); }
+    std::chrono::microseconds mean() const;
+    Snapshot snapshot() const;
+
+    // Upper bound of the bucket holding the given percentile (0-100), capped at max()
+    std::chrono::microseconds percentile(double p) const;
+
+    static size_t bucketIndex(uint64_t us);
+    static uint64_t bucketUpperUs(size_t index);     // Largest value the bucket holds
+
+private:
+    std::atomic<uint64_t> buckets_[BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
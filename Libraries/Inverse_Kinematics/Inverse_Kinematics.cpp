@@ -5,6 +5,9 @@
 #include <kdl/chainiksolverpos_lma.hpp>
 #include <vector>
 
+#include "Inverse_Kinematics.h"
+#include "../Trace/Trace.h"
+
 double get_actual_angle(double angle_rad, double servo_offset, 
                          double servo_min, double servo_max) {
     double degrees = angle_rad * 180.0 / M_PI;
@@ -17,8 +20,9 @@ double get_actual_angle(double angle_rad, double servo_offset,
 
 
 
-std::vector<double> IK_solver(float x, float y, float z, float roll, float pitch, float yaw) 
+std::vector<double> IK_solver(float x, float y, float z, float roll, float pitch, float yaw, IKInfo *info) 
 {
+    TRACE_SCOPE("IK_solver");
     using namespace KDL;
 
 
@@ -112,7 +116,15 @@ std::vector<double> IK_solver(float x, float y, float z, float roll, float pitch
 
     // Output solution
     JntArray q_out(chain.getNrOfJoints());
-    int ret = ik_solver.CartToJnt(q_init, target, q_out);
+    int ret;
+    {
+        TRACE_SCOPE("CartToJnt");
+        ret = ik_solver.CartToJnt(q_init, target, q_out);
+    }
+    if (info) {
+        info->status = ret;
+        info->iterations = ik_solver.lastNrOfIter;
+    }
 
     if(ret >= 0) {
         return std::vector<double>{
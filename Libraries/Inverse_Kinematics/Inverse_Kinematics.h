@@ -2,5 +2,12 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
-std::vector<double> IK_solver(float x, float y, float z, float a, float b, float c);
\ No newline at end of file
+// Solver outcome, for logging
+struct IKInfo {
+    int status;         // KDL error code, >= 0 on success
+    int iterations;
+};
+
+std::vector<double> IK_solver(float x, float y, float z, float a, float b, float c, IKInfo *info = nullptr);
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "Joint_State.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint32_t STATE_MAGIC = 0x4A4F4E54;    // "JONT"
+constexpr uint32_t STATE_VERSION = 1;
+}
+
+JointStateFile::JointStateFile(std::string path) : path_(std::move(path)), fd_(-1), state_(nullptr) {}
+
+JointStateFile::~JointStateFile() {
+    close();
+}
+
+bool JointStateFile::open() {
+    if (state_) {
+        return true;
+    }
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    if (ftruncate(fd_, sizeof(State)) != 0) {
+        close();
+        return false;
+    }
+
+    void *map = mmap(nullptr, sizeof(State), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        close();
+        return false;
+    }
+    state_ = static_cast<State *>(map);
+
+    // Fresh or foreign file: start empty
+    if (state_->magic != STATE_MAGIC || state_->version != STATE_VERSION) {
+        std::memset(static_cast<void *>(state_), 0, sizeof(State));
+        state_->magic = STATE_MAGIC;
+        state_->version = STATE_VERSION;
+    }
+
+    // Previous run died inside store(): its angles are torn, drop them and start the
+    // sequence even again, or every later load() would keep failing
+    const uint64_t seq = state_->sequence.load(std::memory_order_relaxed);
+    if (seq & 1) {
+        state_->mask = 0;
+        state_->sequence.store(seq + 1, std::memory_order_release);
+    }
+    return true;
+}
+
+void JointStateFile::close() {
+    if (state_) {
+        munmap(state_, sizeof(State));
+        state_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool JointStateFile::load(float *angles, uint16_t &mask) const {
+    if (!state_) {
+        return false;
+    }
+
+    // A crash in the middle of store() leaves the sequence odd
+    const uint64_t seq = state_->sequence.load(std::memory_order_acquire);
+    if (seq == 0 || (seq & 1)) {
+        return false;
+    }
+
+    mask = state_->mask;
+    std::memcpy(angles, state_->angles, sizeof(state_->angles));
+    return true;
+}
+
+void JointStateFile::store(const float *angles, uint16_t mask) {
+    if (!state_) {
+        return;
+    }
+
+    // Odd while writing and even after it, whatever an interrupted store left behind
+    const uint64_t seq = state_->sequence.load(std::memory_order_relaxed) | 1;
+    state_->sequence.store(seq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    state_->mask = mask;
+    std::memcpy(state_->angles, angles, sizeof(state_->angles));
+
+    state_->sequence.store(seq + 1, std::memory_order_release);
+}
+
+void JointStateFile::flush() {
+    if (state_) {
+        msync(state_, sizeof(State), MS_SYNC);
+    }
+}
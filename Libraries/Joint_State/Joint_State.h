@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Last commanded joint angles in a small memory-mapped file. store() is a plain
+// memory write every tick; the page cache keeps it across process restarts
+// (flush() on clean shutdown to also survive a power loss).
+class JointStateFile {
+public:
+    explicit JointStateFile(std::string path);
+    ~JointStateFile();
+
+    bool open();
+    void close();
+    bool isOpen() const { return state_ != nullptr; }
+
+    // Bit n of mask marks angles[n] as valid
+    bool load(float *angles, uint16_t &mask) const;
+    void store(const float *angles, uint16_t mask);
+    void flush();
+
+private:
+    struct State {
+        uint32_t magic;
+        uint32_t version;
+        std::atomic<uint64_t> sequence;     // Odd while a store is in progress
+        uint16_t mask;
+        float angles[16];
+    };
+
+    std::string path_;
+    int fd_;
+    State *state_;
+};
@@ -0,0 +1,117 @@
+#include "Motion_Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float DEFAULT_MAX_VELOCITY = 120.0f;       // deg/s
+constexpr float DEFAULT_MAX_ACCELERATION = 300.0f;   // deg/s^2
+constexpr float DEFAULT_MAX_JERK = 3000.0f;          // deg/s^3
+constexpr float DEFAULT_ANGLE = 90.0f;
+constexpr float MAX_DT = 0.1f;                       // Don't jump after a stall
+constexpr float NO_JERK_LIMIT = 1e30f;
+
+// Value-returning min/max so the update loop if-converts into vector selects
+inline float minf(float a, float b) { return a < b ? a : b; }
+inline float maxf(float a, float b) { return a > b ? a : b; }
+inline float clampf(float x, float lo, float hi) { return minf(maxf(x, lo), hi); }
+}
+
+MotionProfiler::MotionProfiler(Mode mode) : s_{}, mode_(mode), started_(false) {
+    for (int i = 0; i < CHANNELS; i++) {
+        s_.pos[i] = DEFAULT_ANGLE;
+        s_.target[i] = DEFAULT_ANGLE;
+        s_.vmax[i] = DEFAULT_MAX_VELOCITY;
+        s_.amax[i] = DEFAULT_MAX_ACCELERATION;
+        s_.jmax[i] = DEFAULT_MAX_JERK;
+    }
+}
+
+bool MotionProfiler::setLimits(uint8_t channel, float maxVelocity, float maxAcceleration, float maxJerk) {
+    if (channel >= CHANNELS || maxVelocity <= 0.0f || maxAcceleration <= 0.0f || maxJerk <= 0.0f) {
+        return false;
+    }
+
+    s_.vmax[channel] = maxVelocity;
+    s_.amax[channel] = maxAcceleration;
+    s_.jmax[channel] = maxJerk;
+    return true;
+}
+
+bool MotionProfiler::setTarget(uint8_t channel, float angle) {
+    if (channel >= CHANNELS) {
+        return false;
+    }
+
+    s_.target[channel] = angle;
+    return true;
+}
+
+void MotionProfiler::setTargets(const float *targets) {
+    std::copy(targets, targets + CHANNELS, s_.target);
+}
+
+bool MotionProfiler::reset(uint8_t channel, float angle) {
+    if (channel >= CHANNELS) {
+        return false;
+    }
+
+    s_.pos[channel] = angle;
+    s_.target[channel] = angle;
+    s_.vel[channel] = 0.0f;
+    s_.acc[channel] = 0.0f;
+    return true;
+}
+
+void MotionProfiler::update(std::chrono::steady_clock::time_point now) {
+    if (!started_) {
+        last_ = now;
+        started_ = true;
+        return;
+    }
+
+    float dt = std::chrono::duration<float>(now - last_).count();
+    last_ = now;
+    update(dt);
+}
+
+void MotionProfiler::update(float dt) {
+    if (dt <= 0.0f) {
+        return;
+    }
+    dt = std::min(dt, MAX_DT);
+
+    // Mode is uniform across lanes, hoist it out as plain factors
+    const bool scurve = mode_ == Mode::SCurve;
+    const float jerkReserve = scurve ? 0.5f : 0.0f;
+    const float jerkFree = scurve ? 0.0f : NO_JERK_LIMIT;
+    const float inv_dt = 1.0f / dt;
+
+    // Branch-free over all lanes
+    for (int i = 0; i < CHANNELS; i++) {
+        const float err = s_.target[i] - s_.pos[i];
+        const float dist = std::fabs(err);
+        const float dir = err >= 0.0f ? 1.0f : -1.0f;
+        const float vel = s_.vel[i];
+        const float amax = s_.amax[i];
+
+        // Fastest velocity that can still brake to a stop at the target. With a
+        // jerk limit, part of the distance is spent ramping the deceleration up
+        const float ramp = jerkReserve * std::fabs(vel) * amax / s_.jmax[i];
+        const float vstop = std::sqrt(2.0f * amax * maxf(dist - ramp, 0.0f));
+        const float vdes = dir * minf(s_.vmax[i], vstop);
+
+        const float ades = clampf((vdes - vel) * inv_dt, -amax, amax);
+        const float jstep = s_.jmax[i] * dt + jerkFree;
+        const float acc = clampf(s_.acc[i] + clampf(ades - s_.acc[i], -jstep, jstep), -amax, amax);
+
+        const float newVel = clampf(vel + acc * dt, -s_.vmax[i], s_.vmax[i]);
+        const float newPos = s_.pos[i] + newVel * dt;
+
+        // Crossing (or reaching) the target ends the move exactly on it
+        const bool arrived = (s_.target[i] - newPos) * err <= 0.0f;
+        s_.pos[i] = arrived ? s_.target[i] : newPos;
+        s_.vel[i] = arrived ? 0.0f : newVel;
+        s_.acc[i] = arrived ? 0.0f : acc;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Per-channel motion profiler integrating against a monotonic clock, so the
+// arm moves at the same speed no matter how often update() is called.
+class MotionProfiler {
+public:
+    enum class Mode : uint8_t {
+        Trapezoidal,    // Velocity and acceleration limited
+        SCurve,         // Additionally jerk limited
+    };
+
+    static constexpr int CHANNELS = 16;
+
+    explicit MotionProfiler(Mode mode = Mode::Trapezoidal);
+
+    void setMode(Mode mode) { mode_ = mode; }
+    Mode getMode() const { return mode_; }
+
+    // Limits in deg/s, deg/s^2 and deg/s^3
+    bool setLimits(uint8_t channel, float maxVelocity, float maxAcceleration, float maxJerk);
+    bool setTarget(uint8_t channel, float angle);
+    void setTargets(const float *targets);      // All CHANNELS lanes at once
+    bool reset(uint8_t channel, float angle);   // Jump to angle and stand still
+
+    // Advance all channels by the time elapsed since the previous call
+    void update(std::chrono::steady_clock::time_point now);
+    void update(float dt);
+
+    float position(uint8_t channel) const { return s_.pos[channel]; }
+    float velocity(uint8_t channel) const { return s_.vel[channel]; }
+    float target(uint8_t channel) const { return s_.target[channel]; }
+    bool settled(uint8_t channel) const { return s_.pos[channel] == s_.target[channel] && s_.vel[channel] == 0.0f; }
+    const float *positions() const { return s_.pos; }
+    const float *velocities() const { return s_.vel; }
+    const float *targets() const { return s_.target; }
+
+private:
+    // Structure of arrays, one lane per channel so update() vectorizes
+    struct alignas(64) State {
+        float pos[CHANNELS];
+        float vel[CHANNELS];
+        float acc[CHANNELS];
+        float target[CHANNELS];
+        float vmax[CHANNELS];
+        float amax[CHANNELS];
+        float jmax[CHANNELS];
+    };
+
+    State s_;
+    Mode mode_;
+    std::chrono::steady_clock::time_point last_;
+    bool started_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Bounded lock-free queue, any number of producers and one consumer. Every cell
+// carries a sequence number that says whose turn it is, so push() is one CAS on
+// the enqueue index and pop() never waits. Only atomics and fixed arrays: it
+// works the same when placed in shared memory between processes.
+template <typename T, size_t N>
+class MpscQueue {
+    static_assert(std::is_trivially_copyable_v<T>, "MpscQueue payload must be trivially copyable");
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+public:
+    MpscQueue() : enqueue_(0), dequeue_(0) {
+        for (size_t i = 0; i < N; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // False when full, the caller decides whether to retry or drop
+    bool push(const T &value) {
+        uint64_t pos = enqueue_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells_[pos & (N - 1)];
+            const uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            const int64_t diff = static_cast<int64_t>(seq - pos);
+            if (diff == 0) {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool pop(T &value) {
+        const uint64_t pos = dequeue_.load(std::memory_order_relaxed);
+        Cell &cell = cells_[pos & (N - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+
+        value = cell.value;
+        cell.seq.store(pos + N, std::memory_order_release);
+        dequeue_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        T value;
+    };
+
+    Cell cells_[N];
+    alignas(64) std::atomic<uint64_t> enqueue_;
+    alignas(64) std::atomic<uint64_t> dequeue_;
+};
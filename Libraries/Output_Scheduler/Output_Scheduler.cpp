@@ -0,0 +1,151 @@
+#include "Output_Scheduler.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "../Joint_State/Joint_State.h"
+#include "../PCA9685/I2CUring.h"
+#include "../Trace/Trace.h"
+
+OutputScheduler::OutputScheduler(PCA9685 &pwm, std::chrono::microseconds lead)
+    : pwm_(pwm), lead_(lead), staged_{}, stateFile_(nullptr), running_(false), frames_(0), missed_(0), failed_(0) {}
+
+OutputScheduler::~OutputScheduler() {
+    stop();
+}
+
+bool OutputScheduler::setJoint(uint8_t channel, uint8_t servoType, float angle, float smoothness) {
+    if (channel >= 16) {
+        return false;
+    }
+
+    staged_.joints[channel] = {true, servoType, angle, smoothness};
+    return true;
+}
+
+void OutputScheduler::releaseJoint(uint8_t channel) {
+    if (channel >= 16) {
+        return;
+    }
+
+    staged_.joints[channel].active = false;
+}
+
+void OutputScheduler::publish(std::chrono::steady_clock::time_point sampled) {
+    staged_.sampled = sampled;
+    targets_.publish(staged_);
+}
+
+bool OutputScheduler::start() {
+    if (running_.exchange(true)) {
+        return false;
+    }
+
+    thread_ = std::thread(&OutputScheduler::run, this);
+    return true;
+}
+
+void OutputScheduler::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool OutputScheduler::setRealtime(int priority) {
+    if (!thread_.joinable()) {
+        return false;
+    }
+
+    sched_param param{};
+    param.sched_priority = priority;
+    return pthread_setschedparam(thread_.native_handle(), SCHED_FIFO, &param) == 0;
+}
+
+void OutputScheduler::run() {
+    using clock = std::chrono::steady_clock;
+    auto boundary = clock::now();
+    TRACE_THREAD("output");
+
+    while (running_.load()) {
+        // Re-read every frame so a frequency change takes effect right away
+        const auto period = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(1.0 / pwm_.getPWMFreq()));
+
+        boundary += period;
+
+        // Idle on the ring first, so the last frame's completions reach the bus stats as
+        // they land rather than a frame late
+        I2CUring *ring = pwm_.transport();
+        if (ring) {
+            ring->waitUntil(boundary - lead_);
+        }
+        std::this_thread::sleep_until(boundary - lead_);
+        if (!running_.load()) {
+            break;
+        }
+
+        // Overslept past the boundary: those frames went out with stale values
+        auto now = clock::now();
+        if (now >= boundary) {
+            const auto skipped = (now - boundary) / period + 1;
+            missed_.fetch_add(skipped, std::memory_order_relaxed);
+            boundary += skipped * period;
+        }
+
+        // Bus retries may not push the write past the frame it is meant for
+        const auto start = clock::now();
+        pwm_.setDeadline(boundary);
+        if (!update()) {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        pwm_.clearDeadline();
+        updateTime_.record(clock::now() - start);
+        frames_.fetch_add(1, std::memory_order_relaxed);
+
+        // Write itself ran over the boundary, it latches one frame late
+        if (clock::now() > boundary) {
+            missed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool OutputScheduler::update() {
+    TRACE_SCOPE("output frame");
+    // Latest complete target set, the producer may already be filling the next one
+    if (targets_.update()) {
+        targetAge_.record(std::chrono::steady_clock::now() - targets_.front().sampled);
+    }
+    const Joint *joints = targets_.front().joints;
+
+    // With an io_uring transport the whole tick costs one io_uring_enter
+    I2CUring *ring = pwm_.transport();
+    if (ring) {
+        ring->beginBatch();
+    }
+
+    // Whole joint group goes through one batch kernel, one burst and latches in the same PWM cycle
+    bool ok = true;
+    uint16_t active = 0;
+    float targets[16] = {0};
+    float smoothness[16] = {0};
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        if (joints[ch].active && pwm_.setServoType(ch, joints[ch].servoType)) {
+            targets[ch] = joints[ch].angle;
+            smoothness[ch] = joints[ch].smoothness;
+            active |= (1u << ch);
+        } else if (joints[ch].active) {
+            ok = false;
+        }
+    }
+    ok = pwm_.updateJoints(targets, smoothness, active) && ok;
+    if (ring) {
+        ok = ring->endBatch() && ok;
+    }
+
+    // Nothing posted yet: keep the previous session's angles for the next warm start
+    if (stateFile_ && active != 0) {
+        stateFile_->store(pwm_.profiler().positions(), active);
+    }
+    return ok;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "../PCA9685/PCA9685.h"
+#include "../Histogram/Histogram.h"
+#include "../Triple_Buffer/Triple_Buffer.h"
+
+class JointStateFile;
+
+// Sends one coalesced servo update per PCA9685 PWM frame, timed to land just
+// before the frame boundary. Callers only post targets, the latest one wins.
+//
+// Targets are handed over through a triple buffer: one producer thread stages
+// them with setJoint()/releaseJoint() and makes the whole set visible at once
+// with publish(); the output thread never waits on it.
+//
+// The chip's internal PWM counter can't be read back, so the frame grid is
+// anchored at start() and follows the period of the current PWM frequency.
+class OutputScheduler {
+public:
+    explicit OutputScheduler(PCA9685 &pwm, std::chrono::microseconds lead = std::chrono::microseconds(3000));
+    ~OutputScheduler();
+
+    bool setJoint(uint8_t channel, uint8_t servoType, float angle, float smoothness = 1);
+    void releaseJoint(uint8_t channel);
+    // sampled: when the input behind these targets was read, for targetAge()
+    void publish(std::chrono::steady_clock::time_point sampled = std::chrono::steady_clock::now());
+
+    // Written after every frame with the angles the active joints were driven to
+    void setStateFile(JointStateFile *file) { stateFile_ = file; }
+
+    bool start();
+    void stop();
+    bool running() const { return running_.load(); }
+
+    // SCHED_FIFO for the output thread, after start(). Fails without the needed privileges
+    bool setRealtime(int priority);
+
+    uint64_t frames() const { return frames_.load(std::memory_order_relaxed); }
+    uint64_t missedFrames() const { return missed_.load(std::memory_order_relaxed); }
+    uint64_t failedUpdates() const { return failed_.load(std::memory_order_relaxed); }
+
+    const LatencyHistogram &updateTime() const { return updateTime_; }   // Kernel + bus write per frame
+    const LatencyHistogram &targetAge() const { return targetAge_; }     // Input sample -> first frame carrying it
+
+private:
+    struct Joint {
+        bool active;
+        uint8_t servoType;
+        float angle;
+        float smoothness;
+    };
+
+    struct JointSet {
+        Joint joints[16];
+        std::chrono::steady_clock::time_point sampled;
+    };
+
+    void run();
+    bool update();
+
+    PCA9685 &pwm_;
+    std::chrono::microseconds lead_;
+
+    JointSet staged_;                   // Producer only
+    TripleBuffer<JointSet> targets_;
+    JointStateFile *stateFile_;
+
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> missed_;
+    std::atomic<uint64_t> failed_;
+    LatencyHistogram updateTime_;
+    LatencyHistogram targetAge_;
+};
@@ -0,0 +1,86 @@
+#include "I2CTransaction.h"
+
+#include <cerrno>
+#include <cstring>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+
+I2CTransaction::I2CTransaction(uint16_t address)
+    : nmsgs_(0), used_(0), bytes_(0), address_(address), overflow_(false) {}
+
+bool I2CTransaction::reserve(size_t nmsgs, size_t nbytes) {
+    if (nmsgs_ + nmsgs > MAX_MESSAGES || used_ + nbytes > BUFFER_SIZE) {
+        overflow_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool I2CTransaction::write(uint8_t reg, const uint8_t *data, size_t len) {
+    if ((!data && len > 0) || !reserve(1, len + 1)) {
+        return false;
+    }
+
+    // Register pointer followed by the payload, auto-increment spreads it over the registers
+    uint8_t *buf = buffer_ + used_;
+    buf[0] = reg;
+    if (len > 0) {
+        std::memcpy(buf + 1, data, len);
+    }
+
+    msgs_[nmsgs_++] = {address_, 0, static_cast<uint16_t>(len + 1), buf};
+    used_ += len + 1;
+    bytes_ += len + 1;
+    return true;
+}
+
+bool I2CTransaction::write8(uint8_t reg, uint8_t value) {
+    return write(reg, &value, 1);
+}
+
+bool I2CTransaction::read(uint8_t reg, uint8_t *data, size_t len) {
+    if (!data || len == 0 || !reserve(2, 1)) {
+        return false;
+    }
+
+    uint8_t *ptr = buffer_ + used_;
+    ptr[0] = reg;
+    used_ += 1;
+
+    msgs_[nmsgs_++] = {address_, 0, 1, ptr};
+    msgs_[nmsgs_++] = {address_, I2C_M_RD, static_cast<uint16_t>(len), data};
+    bytes_ += len + 1;
+    return true;
+}
+
+bool I2CTransaction::submit(int fd) {
+    if (fd < 0 || overflow_ || nmsgs_ == 0) {
+        errno = fd < 0 ? EBADF : EINVAL;
+        return false;
+    }
+
+    i2c_rdwr_ioctl_data rdwr = {msgs_, static_cast<uint32_t>(nmsgs_)};
+    int ret = ioctl(fd, I2C_RDWR, &rdwr);
+    if (ret == static_cast<int>(nmsgs_)) {
+        return true;
+    }
+    if (ret >= 0) {
+        errno = EIO;    // Adapter stopped part way through
+    }
+    return false;
+}
+
+bool I2CTransaction::submit(I2CBackend &backend) {
+    if (overflow_ || nmsgs_ == 0) {
+        errno = EINVAL;
+        return false;
+    }
+    return backend.transfer(msgs_, nmsgs_);
+}
+
+void I2CTransaction::clear() {
+    nmsgs_ = 0;
+    used_ = 0;
+    bytes_ = 0;
+    overflow_ = false;
+}
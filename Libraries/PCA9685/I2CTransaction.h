@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/i2c.h>
+
+// Stand-in for the kernel adapter (emulator, tests): takes one I2C_RDWR message
+// set, returns false with errno set like the ioctl would
+class I2CBackend {
+public:
+    virtual ~I2CBackend() = default;
+    virtual bool transfer(i2c_msg *msgs, size_t count) = 0;
+};
+
+// Packs several I2C messages into one I2C_RDWR ioctl (repeated START between
+// messages, a single STOP at the end). All storage lives inside the object, so
+// a transaction built on the stack never allocates.
+class I2CTransaction {
+public:
+    static constexpr size_t MAX_MESSAGES = 8;
+    static constexpr size_t BUFFER_SIZE = 128;  // Fits a full 16-channel LED burst (1 + 64 bytes)
+
+    explicit I2CTransaction(uint16_t address);
+
+    bool write(uint8_t reg, const uint8_t *data, size_t len);
+    bool write8(uint8_t reg, uint8_t value);
+    bool read(uint8_t reg, uint8_t *data, size_t len);   // Register pointer write + repeated-start read
+
+    bool submit(int fd);
+    bool submit(I2CBackend &backend);
+    void clear();
+
+    size_t messageCount() const { return nmsgs_; }
+    size_t byteCount() const { return bytes_; }
+
+private:
+    bool reserve(size_t nmsgs, size_t nbytes);
+
+    i2c_msg msgs_[MAX_MESSAGES];
+    uint8_t buffer_[BUFFER_SIZE];
+    size_t nmsgs_;
+    size_t used_;
+    size_t bytes_;
+    uint16_t address_;
+    bool overflow_;
+};
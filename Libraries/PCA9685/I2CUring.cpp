@@ -0,0 +1,441 @@
+#include "I2CUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+// Tags a write halt() turned into a no-op, above the slot index in user_data
+constexpr uint64_t HALTED_WRITE = 1ull << 32;
+
+// halt() polls for up to HALT_POLLS * HALT_POLL_NS, ~50 ms
+constexpr int HALT_POLLS = 500;
+constexpr long HALT_POLL_NS = 100000;
+
+int uringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg = nullptr,
+               size_t argSize = 0) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+unsigned loadAcquire(unsigned *p) {
+    return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+}
+
+void storeRelease(unsigned *p, unsigned value) {
+    std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+}
+
+template <typename T>
+T *at(void *base, unsigned offset) {
+    return reinterpret_cast<T *>(static_cast<uint8_t *>(base) + offset);
+}
+} // namespace
+
+I2CUring::I2CUring(unsigned entries)
+    : entries_(entries), ringFd_(-1), extArg_(false), batching_(false), halted_(false), submitting_(false), sqRing_(MAP_FAILED),
+      cqRing_(MAP_FAILED), sqRingSize_(0), cqRingSize_(0), sqes_(nullptr), sqesSize_(0), sqHead_(nullptr),
+      sqTail_(nullptr), sqMask_(0), sqArray_(nullptr), cqHead_(nullptr), cqTail_(nullptr), cqMask_(0), cqes_(nullptr),
+      submits_(0), writes_(0), completed_(0), failed_(0), cancelled_(0), inFlight_(0), skipped_(0) {}
+
+I2CUring::~I2CUring() {
+    close();
+}
+
+bool I2CUring::init() {
+    if (ringFd_ >= 0) {
+        return true;
+    }
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ringFd_ = uringSetup(entries_, &params);
+    if (ringFd_ < 0) {
+        return false;   // ENOSYS on old kernels, EPERM when disabled by sysctl or seccomp
+    }
+    extArg_ = params.features & IORING_FEAT_EXT_ARG;
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            close();
+            return false;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    sqHead_ = at<unsigned>(sqRing_, params.sq_off.head);
+    sqTail_ = at<unsigned>(sqRing_, params.sq_off.tail);
+    sqMask_ = *at<unsigned>(sqRing_, params.sq_off.ring_mask);
+    sqArray_ = at<unsigned>(sqRing_, params.sq_off.array);
+    cqHead_ = at<unsigned>(cqRing_, params.cq_off.head);
+    cqTail_ = at<unsigned>(cqRing_, params.cq_off.tail);
+    cqMask_ = *at<unsigned>(cqRing_, params.cq_off.ring_mask);
+    cqes_ = at<io_uring_cqe>(cqRing_, params.cq_off.cqes);
+
+    // Never more writes outstanding than SQ entries, so neither ring can overflow
+    slots_ = std::vector<Slot>(params.sq_entries);
+    freeSlots_.clear();
+    for (uint32_t i = params.sq_entries; i > 0; i--) {
+        freeSlots_.push_back(i - 1);
+    }
+    pending_.clear();
+    pending_.reserve(params.sq_entries);
+    return true;
+}
+
+void I2CUring::close() {
+    if (ringFd_ >= 0) {
+        drain();
+    }
+
+    if (sqes_) {
+        munmap(sqes_, sqesSize_);
+        sqes_ = nullptr;
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = MAP_FAILED;
+    if (sqRing_ != MAP_FAILED) {
+        munmap(sqRing_, sqRingSize_);
+        sqRing_ = MAP_FAILED;
+    }
+    if (ringFd_ >= 0) {
+        ::close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+bool I2CUring::queueWrite(int fd, const uint8_t *data, size_t len, I2CCompletionSink *sink) {
+    if (ringFd_ < 0 || fd < 0 || !data || len == 0 || len > MAX_WRITE) {
+        return false;
+    }
+
+    // Make room from whatever already completed. Completions can wait as task
+    // work until this thread enters the kernel, so give them that chance first
+    if (freeSlots_.empty()) {
+        uringEnter(ringFd_, 0, 0, IORING_ENTER_GETEVENTS);
+        reap();
+    }
+    if (freeSlots_.empty()) {
+        return false;   // Bus is that far behind, drop rather than block
+    }
+
+    const uint32_t index = freeSlots_.back();
+    freeSlots_.pop_back();
+
+    Slot &slot = slots_[index];
+    slot.fd = fd;
+    slot.len = static_cast<uint32_t>(len);
+    slot.submitted = false;
+    slot.sink = sink;
+    std::memcpy(slot.data, data, len);
+    pending_.push_back(index);
+
+    return batching_ || submit();
+}
+
+bool I2CUring::endBatch() {
+    batching_ = false;
+    return submit();
+}
+
+bool I2CUring::submit() {
+    if (ringFd_ < 0) {
+        return false;
+    }
+
+    reap();
+    if (pending_.empty() && *sqTail_ == loadAcquire(sqHead_)) {
+        return true;
+    }
+
+    // Either halt() sees this submit in progress and waits it out, or this sees the halt
+    submitting_.store(true, std::memory_order_seq_cst);
+    if (halted_.load(std::memory_order_seq_cst)) {
+        submitting_.store(false, std::memory_order_release);
+        dropPending();
+        return false;
+    }
+
+    // Writes for one fd form one contiguous linked chain
+    std::stable_sort(pending_.begin(), pending_.end(),
+                     [this](uint32_t a, uint32_t b) { return slots_[a].fd < slots_[b].fd; });
+
+    // A chain can't be linked behind one submitted earlier, and io-wq may run both at
+    // once: skip the fd's writes while its previous chain is in flight, so an older
+    // frame never lands last. The caller's shadow goes stale and the next frame resends
+    size_t kept = 0;
+    for (size_t i = 0; i < pending_.size();) {
+        const int fd = slots_[pending_[i]].fd;
+        size_t end = i;
+        while (end < pending_.size() && slots_[pending_[end]].fd == fd) {
+            end++;
+        }
+
+        const bool busy = std::any_of(slots_.begin(), slots_.end(),
+                                      [fd](const Slot &slot) { return slot.submitted && slot.fd == fd; });
+        for (; i < end; i++) {
+            Slot &slot = slots_[pending_[i]];
+            if (!busy) {
+                pending_[kept++] = pending_[i];
+                continue;
+            }
+            dropped(slot);
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+            freeSlots_.push_back(pending_[i]);
+        }
+    }
+    pending_.resize(kept);
+
+    unsigned tail = *sqTail_;
+    const auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pending_.size(); i++) {
+        Slot &slot = slots_[pending_[i]];
+        slot.submitted = true;
+        slot.sent = now;
+        const unsigned idx = tail & sqMask_;
+        const bool linked = i + 1 < pending_.size() && slots_[pending_[i + 1]].fd == slot.fd;
+
+        io_uring_sqe &sqe = sqes_[idx];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.flags = linked ? IOSQE_IO_LINK : 0;
+        sqe.fd = slot.fd;
+        sqe.off = static_cast<uint64_t>(-1);    // Character device, no file position
+        sqe.addr = reinterpret_cast<uint64_t>(slot.data);
+        sqe.len = slot.len;
+        sqe.user_data = pending_[i];
+
+        sqArray_[idx] = idx;
+        tail++;
+    }
+    storeRelease(sqTail_, tail);
+
+    writes_.fetch_add(pending_.size(), std::memory_order_relaxed);
+    inFlight_.fetch_add(pending_.size(), std::memory_order_relaxed);
+    pending_.clear();
+
+    // Also picks up entries a previous interrupted enter left behind
+    const unsigned toSubmit = tail - loadAcquire(sqHead_);
+    int ret;
+    do {
+        ret = uringEnter(ringFd_, toSubmit, 0, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    submitting_.store(false, std::memory_order_release);
+
+    submits_.fetch_add(1, std::memory_order_relaxed);
+    return ret >= 0;
+}
+
+void I2CUring::dropPending() {
+    for (uint32_t index : pending_) {
+        dropped(slots_[index]);
+        freeSlots_.push_back(index);
+    }
+    cancelled_.fetch_add(pending_.size(), std::memory_order_relaxed);
+    pending_.clear();
+}
+
+void I2CUring::dropped(const Slot &slot) {
+    if (slot.sink) {
+        slot.sink->writeDropped();
+    }
+}
+
+size_t I2CUring::reap() {
+    if (ringFd_ < 0) {
+        return 0;
+    }
+
+    unsigned head = *cqHead_;
+    const unsigned tail = loadAcquire(cqTail_);
+    if (head == tail) {
+        return 0;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    size_t count = 0;
+
+    for (; head != tail; head++, count++) {
+        const io_uring_cqe &cqe = cqes_[head & cqMask_];
+        const uint32_t index = static_cast<uint32_t>(cqe.user_data);
+        Slot &slot = slots_[index];
+        const bool halted = cqe.user_data & HALTED_WRITE;
+
+        if (halted || cqe.res == -ECANCELED) {
+            cancelled_.fetch_add(1, std::memory_order_relaxed);
+            dropped(slot);
+        } else {
+            if (cqe.res != static_cast<int32_t>(slot.len)) {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                completed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (slot.sink) {
+                slot.sink->writeCompleted(cqe.res, slot.len, now - slot.sent);
+            }
+        }
+
+        slot.submitted = false;
+        freeSlots_.push_back(index);
+    }
+
+    storeRelease(cqHead_, head);
+    inFlight_.fetch_sub(count, std::memory_order_relaxed);
+    return count;
+}
+
+bool I2CUring::drain() {
+    if (ringFd_ < 0) {
+        return true;
+    }
+
+    // Submit only once the ring is idle, so nothing queued gets skipped
+    bool ok = true;
+    while (!pending_.empty() || inFlight_.load(std::memory_order_relaxed) > 0) {
+        reap();
+        if (halted_.load(std::memory_order_acquire)) {
+            // Writes halt() cancelled in the SQ only complete once resume() lets them through
+            dropPending();
+            return false;
+        }
+        if (inFlight_.load(std::memory_order_relaxed) == 0) {
+            ok = submit() && ok;
+            continue;
+        }
+
+        // Hand over what an interrupted enter left behind, but block outside the
+        // submitting section so halt() never waits on the bus
+        submitting_.store(true, std::memory_order_seq_cst);
+        int ret = 0;
+        if (!halted_.load(std::memory_order_seq_cst)) {
+            const unsigned leftover = *sqTail_ - loadAcquire(sqHead_);
+            ret = leftover > 0 ? uringEnter(ringFd_, leftover, 0, 0) : 0;
+        }
+        submitting_.store(false, std::memory_order_release);
+        if (ret < 0 && errno != EINTR) {
+            return false;
+        }
+
+        const unsigned unsubmitted = *sqTail_ - loadAcquire(sqHead_);
+        const unsigned waiting = static_cast<unsigned>(inFlight_.load(std::memory_order_relaxed)) - unsubmitted;
+        if (waiting > 0 && uringEnter(ringFd_, 0, waiting, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            return false;
+        }
+        reap();
+    }
+    return ok;
+}
+
+bool I2CUring::waitUntil(std::chrono::steady_clock::time_point deadline) {
+    if (ringFd_ < 0 || !extArg_) {
+        return false;
+    }
+
+    reap();
+    for (;;) {
+        // Writes still sitting in the SQ only go out with the next submit
+        const unsigned unsubmitted = *sqTail_ - loadAcquire(sqHead_);
+        if (inFlight_.load(std::memory_order_relaxed) <= unsubmitted) {
+            return true;
+        }
+        const auto left = deadline - std::chrono::steady_clock::now();
+        if (left <= decltype(left)::zero()) {
+            return true;
+        }
+
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+        __kernel_timespec timeout{ns / 1000000000, ns % 1000000000};
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&timeout);
+        if (uringEnter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) < 0 &&
+            errno != ETIME && errno != EINTR) {
+            return false;
+        }
+        reap();
+    }
+}
+
+bool I2CUring::halt() {
+    if (ringFd_ < 0) {
+        return true;
+    }
+    halted_.store(true, std::memory_order_seq_cst);
+
+    // Bounded: from a signal handler, the interrupted thread may be the one submitting
+    const timespec poll = {0, HALT_POLL_NS};
+    int polls = 0;
+    while (submitting_.load(std::memory_order_seq_cst)) {
+        if (++polls > HALT_POLLS) {
+            return false;
+        }
+        nanosleep(&poll, nullptr);
+    }
+
+    // Nothing enters the kernel with work now. Whatever it hasn't picked up yet becomes
+    // a no-op, reaped as cancelled once resume() lets it through
+    const unsigned head = loadAcquire(sqHead_);
+    const unsigned tail = loadAcquire(sqTail_);
+    for (unsigned pos = head; pos != tail; pos++) {
+        io_uring_sqe &sqe = sqes_[sqArray_[pos & sqMask_]];
+        const uint8_t flags = sqe.flags;
+        const uint64_t userData = sqe.user_data | HALTED_WRITE;
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_NOP;
+        sqe.flags = flags;
+        sqe.user_data = userData;
+    }
+
+    // Each write the kernel took posts exactly one completion, the CQ tail catches up
+    // with the SQ head once the last one is off the bus
+    while (static_cast<int>(loadAcquire(cqTail_) - head) < 0) {
+        if (++polls > HALT_POLLS) {
+            return false;
+        }
+        nanosleep(&poll, nullptr);
+    }
+    return true;
+}
+
+UringStats I2CUring::getStats() const {
+    return {
+        submits_.load(std::memory_order_relaxed),
+        writes_.load(std::memory_order_relaxed),
+        completed_.load(std::memory_order_relaxed),
+        failed_.load(std::memory_order_relaxed),
+        cancelled_.load(std::memory_order_relaxed),
+        inFlight_.load(std::memory_order_relaxed),
+        skipped_.load(std::memory_order_relaxed),
+    };
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+struct UringStats {
+    uint64_t submits;       // io_uring_enter calls that submitted work
+    uint64_t writes;        // Writes handed to the kernel
+    uint64_t completed;
+    uint64_t failed;        // Error or short write
+    uint64_t cancelled;     // Dropped because an earlier write in its chain failed, or by halt()
+    uint64_t inFlight;
+    uint64_t skipped;       // Dropped because the fd still had a write in flight, resent next frame
+};
+
+// Told how each queued write ended, on the thread that submits and reaps the ring
+class I2CCompletionSink {
+public:
+    virtual ~I2CCompletionSink() = default;
+
+    // result is the byte count written or -errno. latency runs from submit to reap,
+    // an upper bound on the bus time
+    virtual void writeCompleted(int result, size_t len, std::chrono::nanoseconds latency) = 0;
+    // Never reached the bus: skipped, cancelled with its chain or by halt()
+    virtual void writeDropped() = 0;
+};
+
+// Non-blocking i2c-dev writes through io_uring, raw syscalls (no liburing).
+//
+// Writes to the same fd are linked so they reach the bus in order, and a failure
+// cancels the rest of that chain. Links only hold within one submit, so writes for
+// an fd whose previous chain is still in flight are skipped (reported dropped, the
+// caller resends its latest values) rather than racing it to the chip; drain()
+// waits instead. Between beginBatch() and endBatch() everything
+// queued (any number of boards and buses) goes to the kernel in a single
+// io_uring_enter; outside a batch each write is submitted right away.
+// Completions are reaped without a syscall on the next submit, or as they arrive
+// while the caller idles in waitUntil().
+//
+// Not thread-safe: queue, submit and reap from one thread at a time. halt() and
+// resume() are the exception, callable from any thread (halt() also from a signal
+// handler) to stop the ring from putting anything more on the bus.
+class I2CUring {
+public:
+    static constexpr size_t MAX_WRITE = 72;     // Register pointer + all 16 channels
+
+    explicit I2CUring(unsigned entries = 64);
+    ~I2CUring();
+
+    bool init();            // False if io_uring is unavailable, stay on the blocking path
+    void close();
+    bool available() const { return ringFd_ >= 0; }
+
+    // sink (may be null) hears how the write ended
+    bool queueWrite(int fd, const uint8_t *data, size_t len, I2CCompletionSink *sink);
+
+    void beginBatch() { batching_ = true; }
+    bool endBatch();
+    bool submit();
+    size_t reap();
+    bool drain();           // Blocks until nothing is in flight, false while halted
+    // Reaps completions as they arrive until nothing is in flight or the deadline passes.
+    // False if the kernel can't wait with a timeout (before 5.11)
+    bool waitUntil(std::chrono::steady_clock::time_point deadline);
+
+    // Writes not yet picked up by the kernel are cancelled, everything queued after
+    // is dropped until resume(). Waits (bounded) for the kernel to finish the writes
+    // already on their way; false if it gave up first
+    bool halt();
+    void resume() { halted_.store(false, std::memory_order_seq_cst); }
+
+    UringStats getStats() const;
+
+private:
+    struct Slot {
+        int fd;
+        uint32_t len;
+        bool submitted;     // Handed to the kernel, completion not reaped yet
+        std::chrono::steady_clock::time_point sent;
+        I2CCompletionSink *sink;
+        uint8_t data[MAX_WRITE];
+    };
+
+    unsigned entries_;
+    int ringFd_;
+    bool extArg_;           // io_uring_enter takes a wait timeout
+    bool batching_;
+
+    // The submitting thread owns the SQ while submitting_ is set; halt() waits it out
+    std::atomic<bool> halted_;
+    std::atomic<bool> submitting_;
+
+    void *sqRing_;
+    void *cqRing_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    // Ring fields, shared with the kernel
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned *sqArray_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    // One slot per write from queueWrite() until its completion is reaped
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> freeSlots_;
+    std::vector<uint32_t> pending_;
+
+    void dropPending();
+    void dropped(const Slot &slot);
+
+    std::atomic<uint64_t> submits_;
+    std::atomic<uint64_t> writes_;
+    std::atomic<uint64_t> completed_;
+    std::atomic<uint64_t> failed_;
+    std::atomic<uint64_t> cancelled_;
+    std::atomic<uint64_t> inFlight_;
+    std::atomic<uint64_t> skipped_;
+};
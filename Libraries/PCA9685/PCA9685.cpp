@@ -1,6 +1,10 @@
 #include "PCA9685.h"
-#include "../Utilities/Utilities.h"
+#include "I2CTransaction.h"
+#include "I2CUring.h"
+#include "../Trace/Trace.h"
 
+#include <algorithm>
+#include <bit>
 #include <iostream>
 #include <cmath>
 #include <cerrno>
@@ -8,8 +12,8 @@
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
 #include <sys/ioctl.h>
+#include <thread>
 #include <unistd.h>
-#include <vector>
 
 
 
@@ -18,29 +22,77 @@ constexpr uint8_t MODE1 = 0x00;
 constexpr uint8_t MODE2 = 0x01;
 constexpr uint8_t PRESCALE = 0xFE;
 constexpr uint8_t LED0_ON_L = 0x06;
+constexpr uint8_t ALL_LED_ON_L = 0xFA;
 constexpr uint8_t MODE1_SLEEP = 0x10;
 constexpr uint8_t MODE1_RESTART = 0x80;
 constexpr uint8_t MODE2_OUTDRV = 0x04;
-constexpr float OSC_CLOCK_HZ = 25000000.0f;
-constexpr uint16_t RESOLUTION = 4096;
-constexpr double acc_factor = 0.25;
-#define MS62_SERVO 0     // 25kg servo motor
-constexpr float MS62_MIN_PULSE_MS = 0.5f;
-constexpr float MS62_MAX_PULSE_MS = 2.5f;
-constexpr uint16_t MS62_MAX_ANGLE = 270;
-#define DM996_SERVO 1   // 15kg servo motor
-constexpr float DM996_MIN_PULSE_MS = 0.5f;
-constexpr float DM996_MAX_PULSE_MS = 2.5f;
-constexpr uint16_t DM996_MAX_ANGLE = 180;
-#define MS62_SERVO_A 2  // Special case
-constexpr float MS62_A_MIN_PULSE_MS = 0.611f;
-constexpr float MS62_A_MAX_PULSE_MS = 2.322f;
-constexpr uint16_t MS62_A_MIN_ANGLE = 15;
-constexpr uint16_t MS62_A_MAX_ANGLE = 246;
+constexpr uint8_t MODE2_OCH = 0x08;     // Set: outputs change on ACK, cleared: on STOP
+constexpr auto HOMING_STEP = std::chrono::milliseconds(20);
+constexpr RetryPolicy DEFAULT_RETRY = {3, std::chrono::microseconds(200), std::chrono::microseconds(2000)};
+
+// errno -> BusStats::errnoCounts slot
+size_t errnoSlot(int err) {
+    switch (err) {
+        case EREMOTEIO: return 0;   // NACK
+        case EIO:       return 1;
+        case ETIMEDOUT: return 2;
+        case EAGAIN:    return 3;   // Arbitration lost / bus busy
+        case ENXIO:     return 4;
+        default:        return 5;
+    }
+}
+
+// Retrying won't fix a bad fd or a malformed transaction
+bool transientError(int err) {
+    return err != EBADF && err != EINVAL && err != ENOTTY && err != EOPNOTSUPP;
+}
+
+// Value-returning min/max so the lane loops if-convert into vector selects
+inline float minf(float a, float b) { return a < b ? a : b; }
+inline float maxf(float a, float b) { return a > b ? a : b; }
+inline float clampf(float x, float lo, float hi) { return minf(maxf(x, lo), hi); }
+
+// Linear interpolation between calibration points, extrapolating the end segments
+float correctAngle(const std::vector<AngleCorrectionPoint> &points, float angle) {
+    if (points.size() == 1) {
+        return angle + (points[0].output - points[0].commanded);
+    }
+
+    size_t i = 1;
+    while (i < points.size() - 1 && angle > points[i].commanded) {
+        i++;
+    }
+
+    const AngleCorrectionPoint &a = points[i - 1];
+    const AngleCorrectionPoint &b = points[i];
+    return a.output + (angle - a.commanded) * (b.output - a.output) / (b.commanded - a.commanded);
+}
 } // namespace
 
-PCA9685::PCA9685(uint8_t address, std::string i2c_device)
-    : fd_(-1), address_(address), i2c_device_(std::move(i2c_device)), current_freq_hz_(50.0f) {}
+PCA9685::PCA9685(uint8_t address, std::string i2c_device, float pwm_freq_hz)
+    : fd_(-1), open_(false), backend_(nullptr), address_(address), i2c_device_(std::move(i2c_device)),
+      requested_freq_hz_(pwm_freq_hz), current_freq_hz_(prescaleFreq(prescaleFor(pwm_freq_hz))),
+      prescale_(prescaleFor(pwm_freq_hz)),
+      shadowStale_(true), estop_(false), staging_(false), stagedMask_(0), adopted_(0), updates_(0), hysteresisSkips_(0),
+      shadowSkips_(0), channelWrites_(0), busWrites_(0), ring_(nullptr), retry_(DEFAULT_RETRY),
+      deadline_(std::chrono::steady_clock::time_point::max()), transactions_(0), bytes_(0), errors_(0), retries_(0),
+      failures_(0) {
+    for (auto &count : errnoCounts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < 16; i++) {
+        lastOn_[i] = 0xFFFF;
+        lastOff_[i] = 0xFFFF;
+        tickTable_[i] = nullptr;
+        tickTableMax_[i] = 0;
+        channelType_[i] = 0xFF;
+        hysteresis_[i] = 0.0f;
+        lastSentAngle_[i] = NAN;
+        limitLo_[i] = 0.0f;
+        limitHi_[i] = 0.0f;
+    }
+    rebuildTickTables();
+}
 
 PCA9685::~PCA9685() {
     close();
@@ -84,17 +136,20 @@ PCA9685::~PCA9685() {
 //    return setPWMFreq(current_freq_hz_);
 //}
 
-bool PCA9685::open() {
-    if (fd_ >= 0) return true;
+bool PCA9685::open(StartMode mode) {
+    if (open_) return true;
 
-    fd_ = ::open(i2c_device_.c_str(), O_RDWR);
-    if (fd_ < 0) return false;
+    if (!backend_) {
+        fd_ = ::open(i2c_device_.c_str(), O_RDWR);
+        if (fd_ < 0) return false;
 
-    if (ioctl(fd_, I2C_SLAVE, address_) < 0) {
-        ::close(fd_);
-        fd_ = -1;
-        return false;
+        if (ioctl(fd_, I2C_SLAVE, address_) < 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
     }
+    open_ = true;
 
     uint8_t mode1 = 0;
     if (!read8(MODE1, mode1)) {
@@ -102,32 +157,117 @@ bool PCA9685::open() {
        return false;
     }
 
-    // Reset chip: MODE1=0x00 (awake, AI cleared), MODE2=OUTDRV
-    uint8_t newmode = static_cast<uint8_t>((mode1 & ~MODE1_SLEEP) | 0x20);
-    if (!write8(MODE1, newmode)) { 
-        close(); 
-        return false; 
+    // Chip kept running since the last session: take over without a glitch
+    if (mode == StartMode::Warm && warmAttach(mode1)) {
+        return true;
     }
-    if (!write8(MODE2, MODE2_OUTDRV)) { 
-        close(); 
-        return false; 
+
+    // Wake up with auto-increment (AI bit = 0x20) and set totem-pole output in one transaction.
+    // OCH stays cleared so a multi-channel burst takes effect at its single STOP, not per ACK
+    uint8_t newmode = static_cast<uint8_t>((mode1 & ~MODE1_SLEEP) | 0x20);
+    I2CTransaction init(address_);
+    init.write8(MODE1, newmode);
+    init.write8(MODE2, MODE2_OUTDRV & ~MODE2_OCH);
+    if (!transfer(init)) {
+        close();
+        return false;
     }
 
     // Set PWM frequency
-    if (!setPWMFreq(current_freq_hz_)) {
+    if (!setPWMFreq(requested_freq_hz_)) {
         close();
         return false;
     }
 
     // Clear all channels (full-off)
-    for (int i = 0; i < 16; i++) {
-        setPWM(i, 0, 4096); // full-off
+    return allOff();
+}
+
+bool PCA9685::warmAttach(uint8_t mode1) {
+    // Asleep or at another frame rate (power cycle, reset, other config): nothing to adopt
+    uint8_t prescale = 0;
+    if ((mode1 & MODE1_SLEEP) || !read8(PRESCALE, prescale) || prescale != prescale_) {
+        return false;
+    }
+
+    // Make sure AI and OUTDRV/OCH are ours, then read all 16 channels in one burst.
+    // RESTART is write-1-to-act, keep it cleared so the running PWM isn't touched
+    uint8_t regs[64];
+    I2CTransaction txn(address_);
+    txn.write8(MODE1, static_cast<uint8_t>((mode1 & ~MODE1_RESTART) | 0x20));
+    txn.write8(MODE2, MODE2_OUTDRV & ~MODE2_OCH);
+    txn.read(LED0_ON_L, regs, sizeof(regs));
+    if (!transfer(txn)) {
+        return false;
     }
 
+    syncShadow();
+    adopted_ = 0;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        const uint8_t *r = regs + 4 * ch;
+        lastOn_[ch] = static_cast<uint16_t>(r[0] | ((r[1] & 0x1F) << 8));
+        lastOff_[ch] = static_cast<uint16_t>(r[2] | ((r[3] & 0x1F) << 8));
+
+        // Only a plain servo pulse on a declared channel can be turned back into an angle
+        if (channelType_[ch] == 0xFF || lastOn_[ch] != 0 || lastOff_[ch] == 0 || lastOff_[ch] >= PWM_RESOLUTION) {
+            continue;
+        }
+
+        const float angle = ticksToAngle(ch, lastOff_[ch]);
+        profiler_.reset(ch, angle);
+        lastSentAngle_[ch] = angle;
+        adopted_ |= (1u << ch);
+    }
+
+    std::cout << "PCA9685 warm attach: adopted " << std::popcount(adopted_) << " running channel(s)." << std::endl;
+    return true;
+}
+
+float PCA9685::ticksToAngle(uint8_t channel, uint16_t off) const {
+    // Tables rise with the angle: take the middle of the run of angles giving this tick
+    const uint16_t *first = tickTable_[channel];
+    const uint16_t *last = first + tickTableMax_[channel] + 1;
+    const uint16_t *lo = std::lower_bound(first, last, off);
+    const uint16_t *hi = std::upper_bound(lo, last, off);
+
+    int32_t q = static_cast<int32_t>((lo - first) + (hi - first) - 1) / 2;
+    if (lo == hi) {
+        q = static_cast<int32_t>(lo - first);   // Between two ticks or outside the table
+    }
+    return fromAngleQ(std::clamp(q, int32_t{0}, tickTableMax_[channel]));
+}
+
+bool PCA9685::setServoType(uint8_t channel, uint8_t servoType) {
+    return channel < 16 && (channelType_[channel] == servoType || bindChannel(channel, servoType));
+}
+
+bool PCA9685::resumeFrom(const float *angles, uint16_t mask) {
+    if (!angles) {
+        return false;
+    }
+
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        if (!(mask & (1u << ch)) || channelType_[ch] == 0xFF || !std::isfinite(angles[ch])) {
+            continue;
+        }
+
+        // What the chip really outputs wins over a file that disagrees with it
+        if (adopted_ & (1u << ch)) {
+            if (angleTicks(ch, toAngleQ(angles[ch])) == lastOff_[ch]) {
+                profiler_.reset(ch, angles[ch]);
+                lastSentAngle_[ch] = angles[ch];
+            }
+            continue;
+        }
+
+        // Channel is off: best guess of where the arm was left
+        profiler_.reset(ch, angles[ch]);
+    }
     return true;
 }
 
 void PCA9685::close() {
+    open_ = false;
     if (fd_ >= 0) {
         ::close(fd_);
         fd_ = -1;
@@ -135,7 +275,7 @@ void PCA9685::close() {
 }
 
 bool PCA9685::sleep() {
-    if (fd_ < 0) {
+    if (!open_) {
         return false;
     }
 
@@ -190,13 +330,16 @@ bool PCA9685::sleep() {
 //}
 
 bool PCA9685::setPWMFreq(float freq_hz) {
-    if (fd_ < 0) {
+    if (!open_) {
         return false;
     }
 
-    // Compute prescaler
-    float prescaleval = (OSC_CLOCK_HZ / (RESOLUTION * freq_hz)) - 1.0f;
-    uint8_t prescale = static_cast<uint8_t>(std::lround(prescaleval));
+    // Compute prescaler and the frame rate it really gives
+    uint8_t prescale = prescaleFor(freq_hz);
+    float actual_hz = prescaleFreq(prescale);
+    if (!frequencySupported(freq_hz, actual_hz)) {
+        return false;
+    }
 
     // Read MODE1
     uint8_t oldmode;
@@ -204,13 +347,12 @@ bool PCA9685::setPWMFreq(float freq_hz) {
         return false;
     }
 
-    // Enter sleep to set prescaler
+    // Enter sleep and set prescaler (only writable while asleep) in one transaction
     uint8_t sleepmode = (oldmode & 0x7F) | MODE1_SLEEP;
-    if (!write8(MODE1, sleepmode)) {
-        return false;
-    }
-
-    if (!write8(PRESCALE, prescale)) {
+    I2CTransaction txn(address_);
+    txn.write8(MODE1, sleepmode);
+    txn.write8(PRESCALE, prescale);
+    if (!transfer(txn)) {
         return false;
     }
 
@@ -226,10 +368,37 @@ bool PCA9685::setPWMFreq(float freq_hz) {
         return false;
     }
 
-    current_freq_hz_ = freq_hz;
+    requested_freq_hz_ = freq_hz;
+    prescale_ = prescale;
+    current_freq_hz_ = actual_hz;
+    rebuildTickTables();
+
+    std::cout << "PWM " << freq_hz << " Hz: prescaler " << static_cast<int>(prescale) << ", actual "
+              << actual_hz << " Hz (" << (actual_hz - freq_hz) / freq_hz * 100.0f << "% error)." << std::endl;
+    return true;
+}
+
+bool PCA9685::frequencySupported(float freq_hz, float actual_hz) const {
+    if (freq_hz < prescaleFreq(255) || freq_hz > prescaleFreq(MIN_PRESCALE)) {
+        std::cerr << "PWM frequency " << freq_hz << " Hz is outside the PCA9685 range." << std::endl;
+        return false;
+    }
+
+    // Every servo type in use must accept the frame rate and fit its pulse in the period
+    for (int ch = 0; ch < 16; ch++) {
+        if (channelType_[ch] != 0xFF && !profileSupports(channelType_[ch], actual_hz)) {
+            std::cerr << "PWM frequency " << actual_hz << " Hz is too high for the servo on channel " << ch << "." << std::endl;
+            return false;
+        }
+    }
     return true;
 }
 
+bool PCA9685::profileSupports(uint8_t servoType, float freq_hz) {
+    const ServoProfile &profile = SERVO_PROFILES[servoType];
+    return freq_hz <= profile.maxFreqHz && profile.maxPulseMs < 1000.0f / freq_hz;
+}
+
 bool PCA9685::reset()
 {
     // Put chip to sleep first
@@ -262,18 +431,25 @@ bool PCA9685::reset()
 }
 
 bool PCA9685::setPWM(uint8_t channel, uint16_t on, uint16_t off) {
-    if (fd_ < 0 || channel >= 16) {
+    if (!open_ || channel >= 16 || estop_.load(std::memory_order_acquire)) {
         return false;
     }
 
-    // Track last values to avoid redundant writes
-    static uint16_t lastOn[16] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
-                                   0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF};
-    static uint16_t lastOff[16] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
-                                    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF};
+    syncShadow();
+    updates_.fetch_add(1, std::memory_order_relaxed);
 
     // Skip write if value unchanged
-    if (lastOn[channel] == on && lastOff[channel] == off) {
+    if (lastOn_[channel] == on && lastOff_[channel] == off) {
+        stagedMask_ &= ~(1u << channel);
+        shadowSkips_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Staged: collect now, send the whole group in commitUpdate()
+    if (staging_) {
+        stagedOn_[channel] = on;
+        stagedOff_[channel] = off;
+        stagedMask_ |= (1u << channel);
         return true;
     }
 
@@ -286,128 +462,616 @@ bool PCA9685::setPWM(uint8_t channel, uint16_t on, uint16_t off) {
 
     uint8_t reg = (LED0_ON_L + 4 * channel);
 
-    if (writeBlock(reg, data, sizeof(data))) {
-        lastOn[channel] = on;
-        lastOff[channel] = off;
+    if (sendBlock(reg, data, sizeof(data))) {
+        lastOn_[channel] = on;
+        lastOff_[channel] = off;
+        channelWrites_.fetch_add(1, std::memory_order_relaxed);
+        busWrites_.fetch_add(1, std::memory_order_relaxed);
+
+        // E-stop raised (e.g. from a signal handler) while this write was in flight
+        if (estop_.load(std::memory_order_acquire)) {
+            allOff();
+            return false;
+        }
         return true;
     }
+
+    // Unknown what the chip holds now, make sure the next value goes out
+    lastOn_[channel] = 0xFFFF;
+    lastOff_[channel] = 0xFFFF;
+    lastSentAngle_[channel] = NAN;
     return false;
 }
 
-bool PCA9685::setServoPulse(uint8_t channel, float pulse_ms) {
+uint16_t PCA9685::pulseToTicks(float pulse_ms) const {
     float period_ms = 1000.0f / current_freq_hz_;
-    float ticks = (pulse_ms / period_ms) * RESOLUTION;
+    float ticks = (pulse_ms / period_ms) * PWM_RESOLUTION;
 
     if (ticks < 0.0f) {
         ticks = 0.0f;
     }
 
-    if (ticks > (RESOLUTION - 1)) {
-        ticks = RESOLUTION - 1;
+    if (ticks > (PWM_RESOLUTION - 1)) {
+        ticks = PWM_RESOLUTION - 1;
     }
 
-    return setPWM(channel, 0, static_cast<uint16_t>(std::lround(ticks)));
+    return static_cast<uint16_t>(std::lround(ticks));
+}
+
+bool PCA9685::setServoPulse(uint8_t channel, float pulse_ms) {
+    return setPWM(channel, 0, pulseToTicks(pulse_ms));
 }
 
 
-bool PCA9685::setServoAngle(uint8_t channel, uint8_t servoType, uint16_t servoAngle) {
-    float val = 0.0f;
+bool PCA9685::setServoAngle(uint8_t channel, uint8_t servoType, float servoAngle) {
+    if (channel >= 16) {
+        return false;
+    }
 
-    // Use appropiate servo angle calculation
-    switch(servoType) {
-        case MS62_SERVO:
-            val = constrain(map(servoAngle, 0, MS62_MAX_ANGLE, MS62_MIN_PULSE_MS, MS62_MAX_PULSE_MS), MS62_MIN_PULSE_MS, MS62_MAX_PULSE_MS);
-            break;
-        case DM996_SERVO:
-            val = constrain(map(servoAngle, 0, DM996_MAX_ANGLE, DM996_MIN_PULSE_MS, DM996_MAX_PULSE_MS), DM996_MIN_PULSE_MS, DM996_MAX_PULSE_MS);
-            break;
-        case MS62_SERVO_A:
-            val = constrain(map(servoAngle, MS62_A_MIN_ANGLE, MS62_A_MAX_ANGLE, MS62_A_MIN_PULSE_MS, MS62_A_MAX_PULSE_MS), MS62_A_MIN_PULSE_MS, MS62_A_MAX_PULSE_MS);
-            break;
-        default:
-            std::cerr << "Incorrect servo-type index was inputted." << std::endl;
+    // Use appropiate servo angle table
+    if (channelType_[channel] != servoType && !bindChannel(channel, servoType)) {
+        std::cerr << "Incorrect servo-type index was inputted, or the PWM frequency is too high for it." << std::endl;
+        return false;
+    }
+
+    return setPWM(channel, 0, angleTicks(channel, toAngleQ(servoAngle)));
+}
+
+bool PCA9685::setAngleCorrection(uint8_t channel, const AngleCorrectionPoint *points, size_t count) {
+    if (channel >= 16 || (count > 0 && !points)) {
+        return false;
+    }
+
+    std::vector<AngleCorrectionPoint> sorted(points, points + count);
+    std::sort(sorted.begin(), sorted.end(), [](const AngleCorrectionPoint &a, const AngleCorrectionPoint &b) {
+        return a.commanded < b.commanded;
+    });
+    for (size_t i = 1; i < sorted.size(); i++) {
+        if (sorted[i].commanded == sorted[i - 1].commanded) {
             return false;
+        }
+    }
+
+    correction_[channel] = std::move(sorted);
+    return channelType_[channel] == 0xFF || bindChannel(channel, channelType_[channel]);
+}
+
+bool PCA9685::bindChannel(uint8_t channel, uint8_t servoType) {
+    if (servoType >= SERVO_PROFILE_COUNT || !profileSupports(servoType, current_freq_hz_)) {
+        return false;
     }
 
-    //std::cout << "Channel: " << (int)channel << ", Pulse: " << val << std::endl;
+    const ServoProfile &profile = SERVO_PROFILES[servoType];
+    const size_t size = tickTableSize(profile);
+    channelType_[channel] = servoType;
+    tickTableMax_[channel] = static_cast<int32_t>(size - 1);
+    limitLo_[channel] = 0.0f;
+    limitHi_[channel] = fromAngleQ(tickTableMax_[channel]);
 
-    return setServoPulse(channel, val);
+    if (correction_[channel].empty()) {
+        correctedTicks_[channel].clear();
+        tickTable_[channel] = profileTicks_[servoType].empty() ? DEFAULT_TICK_TABLES[servoType]
+                                                                : profileTicks_[servoType].data();
+        return true;
+    }
+
+    // Calibrated channel gets its own table, the hot path stays a single load
+    correctedTicks_[channel].resize(size);
+    for (size_t i = 0; i < size; i++) {
+        float angle = correctAngle(correction_[channel], fromAngleQ(static_cast<int32_t>(i)));
+        correctedTicks_[channel][i] = angleToTick(profile, angle, current_freq_hz_);
+    }
+    tickTable_[channel] = correctedTicks_[channel].data();
+    return true;
 }
 
-bool PCA9685::setSmoothServoAngle(uint8_t channel, uint8_t servoType, uint16_t servoAngle, float smoothness) {
+void PCA9685::rebuildTickTables() {
+    for (size_t p = 0; p < SERVO_PROFILE_COUNT; p++) {
+        if (current_freq_hz_ == DEFAULT_PWM_FREQ_HZ) {
+            profileTicks_[p].clear();   // Compile-time table applies
+            continue;
+        }
+
+        const size_t size = tickTableSize(SERVO_PROFILES[p]);
+        profileTicks_[p].resize(size);
+        for (size_t i = 0; i < size; i++) {
+            profileTicks_[p][i] = angleToTick(SERVO_PROFILES[p], fromAngleQ(static_cast<int32_t>(i)), current_freq_hz_);
+        }
+    }
+
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        if (channelType_[ch] != 0xFF) {
+            bindChannel(ch, channelType_[ch]);
+        }
+    }
+}
+
+bool PCA9685::setSmoothServoAngle(uint8_t channel, uint8_t servoType, float servoAngle, float smoothness) {
+    TRACE_SCOPE("setSmoothServoAngle");
     if (channel >= 16) {
         return false;
     }
 
-    servoAngle = fmod(servoAngle, 360.0);
+    servoAngle = std::fmod(servoAngle, 360.0f);
+
+    // Ignore target changes inside the deadband, the profiler keeps heading for the old one
+    if (std::abs(servoAngle - profiler_.target(channel)) >= smoothness * 1.1f) {
+        profiler_.setTarget(channel, servoAngle);
+    }
+
+    // Integrates every channel by the real time elapsed, independent of the call rate
+    profiler_.update(std::chrono::steady_clock::now());
+    const float angle = profiler_.position(channel);
 
-    static double currentAngle[16] = {0}; // Current angle of servos
-    static double delta[16] = {0};             // Delta between current angle and desired angle
-    static double curve[16] = {0};          // Curve profile for each servo
-    static double speed[16] = {0};          // Speed profile for each servo
-    static bool initializer = true;         // To initialize all values
+    // Hysteresis: sub-threshold changes stay off the bus, except the final value once settled
+    syncShadow();
+    const float moved = std::abs(angle - lastSentAngle_[channel]);
+    if (moved < hysteresis_[channel] && !(profiler_.settled(channel) && moved > 0.0f)) {
+        hysteresisSkips_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
 
-    if(initializer) {
-        for(int i = 0; i < 16; i++) {
-            speed[i] = 1;
-            currentAngle[i] = 90; // In the future, make it so it remembers its last position instead!
+    if (!setServoAngle(channel, servoType, angle)) {
+        return false;
+    }
+    lastSentAngle_[channel] = angle;
+    return true;
+}
+
+bool PCA9685::updateJoints(const float *targets, const float *smoothness, uint16_t mask) {
+    TRACE_SCOPE("updateJoints");
+    if (!targets || !smoothness) {
+        return false;
+    }
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        if ((mask & (1u << ch)) && channelType_[ch] == 0xFF) {
+            return false;
         }
-        initializer = false;
-    }
-
-    delta[channel] = static_cast<int>(servoAngle) - static_cast<int>(currentAngle[channel]);
-
-    // Curve profile log10 
-    curve[channel] = log10(abs(delta[channel]) + 1) * 3;
-    
-    // Acceleration profile 
-    if(speed[channel] < curve[channel]) {
-        speed[channel] *= 1 + acc_factor;
-    } else if(speed[channel] > curve[channel] && speed[channel] > 0.5) {
-        speed[channel] *= 1 - acc_factor;
-    } 
-    //std::cout << "Channel " << (int)channel << " speed: " << speed[channel] << std::endl;
-
-    //double curve = pow(abs(delta), 2);
-    
-    if (std::abs(delta[channel]) >= static_cast<int>(smoothness) * 1.1) {
-        if (delta[channel] > 0) {
-            currentAngle[channel] = static_cast<uint16_t>(currentAngle[channel] + speed[channel]);
+    }
+    if (mask == 0) {
+        return true;
+    }
+
+    alignas(64) float lane[16];
+    alignas(64) float goal[16];
+    alignas(64) float angle[16];
+    alignas(64) int32_t send[16];
+    alignas(64) int32_t index[16];
+    for (int i = 0; i < 16; i++) {
+        lane[i] = static_cast<float>((mask >> i) & 1u);
+    }
+
+    // Wrap, limit and deadband the targets; lanes not in mask keep their old target
+    const float *prev = profiler_.targets();
+    for (int i = 0; i < 16; i++) {
+        float t = targets[i] - 360.0f * static_cast<float>(static_cast<int32_t>(targets[i] / 360.0f));
+        t = clampf(t, limitLo_[i], limitHi_[i]);
+        const bool move = (lane[i] != 0.0f) & (std::fabs(t - prev[i]) >= smoothness[i] * 1.1f);
+        goal[i] = move ? t : prev[i];
+    }
+
+    profiler_.setTargets(goal);
+    profiler_.update(std::chrono::steady_clock::now());
+
+    // Hysteresis and table index per lane, same rules as setSmoothServoAngle
+    syncShadow();
+    const float *pos = profiler_.positions();
+    const float *vel = profiler_.velocities();
+    for (int i = 0; i < 16; i++) {
+        const float a = clampf(pos[i], limitLo_[i], limitHi_[i]);
+        const float moved = std::fabs(a - lastSentAngle_[i]);
+        const bool settled = (pos[i] == goal[i]) & (vel[i] == 0.0f);
+        const bool skip = (moved < hysteresis_[i]) & !(settled & (moved > 0.0f));
+
+        angle[i] = a;
+        send[i] = (lane[i] != 0.0f) & !skip;
+        index[i] = static_cast<int32_t>(a * ANGLE_ONE + 0.5f);  // a >= 0, rounds like toAngleQ
+    }
+
+    // Table lookup stays a load per lane so calibrated tables apply unchanged
+    uint8_t channels[16];
+    uint16_t on[16] = {0};
+    uint16_t off[16];
+    size_t count = 0;
+    uint64_t sent = 0;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        if (!send[ch]) {
+            continue;
+        }
+        sent++;
+
+        const uint16_t tick = angleTicks(ch, index[ch]);
+        if (lastOn_[ch] == 0 && lastOff_[ch] == tick) {
+            shadowSkips_.fetch_add(1, std::memory_order_relaxed);
+            lastSentAngle_[ch] = angle[ch];
+            continue;
+        }
+        channels[count] = ch;
+        off[count] = tick;
+        count++;
+    }
+
+    updates_.fetch_add(sent, std::memory_order_relaxed);
+    hysteresisSkips_.fetch_add(std::popcount(mask) - sent, std::memory_order_relaxed);
+    if (count == 0) {
+        return true;
+    }
+
+    // A split burst can fail in part: only what the shadow says went out counts as sent
+    const bool ok = writeChannels(channels, on, off, count);
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t ch = channels[i];
+        if (lastOn_[ch] == on[i] && lastOff_[ch] == off[i]) {
+            lastSentAngle_[ch] = angle[ch];
+        }
+    }
+    return ok;
+}
+
+bool PCA9685::setHysteresis(uint8_t channel, float degrees) {
+    if (channel >= 16 || degrees < 0.0f) {
+        return false;
+    }
+
+    hysteresis_[channel] = degrees;
+    return true;
+}
+
+OutputStats PCA9685::getOutputStats() const {
+    return {
+        updates_.load(std::memory_order_relaxed),
+        hysteresisSkips_.load(std::memory_order_relaxed),
+        shadowSkips_.load(std::memory_order_relaxed),
+        channelWrites_.load(std::memory_order_relaxed),
+        busWrites_.load(std::memory_order_relaxed),
+    };
+}
+
+bool PCA9685::allOff() {
+    if (!open_) {
+        return false;
+    }
+
+    // ALL_LED_ON_L..ALL_LED_OFF_H, full-off bit set in ALL_LED_OFF_H. A few immediate
+    // retries, no backoff: this must not sleep and must work from a signal handler
+    const uint8_t buffer[5] = {ALL_LED_ON_L, 0x00, 0x00, 0x00, 0x10};
+    bool ok = false;
+    for (int attempt = 0; attempt < 3 && !ok; attempt++) {
+        if (backend_) {
+            I2CTransaction txn(address_);
+            ok = txn.write(buffer[0], buffer + 1, sizeof(buffer) - 1) && txn.submit(*backend_);
         } else {
-            currentAngle[channel] = static_cast<uint16_t>(currentAngle[channel] - speed[channel]);
+            ok = ::write(fd_, buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer));
+        }
+    }
+    shadowStale_.store(true, std::memory_order_release);
+    return ok;
+}
+
+bool PCA9685::emergencyStop() {
+    // Latch first so no other thread re-energizes a channel after the broadcast
+    estop_.store(true, std::memory_order_release);
+    bool ok = allOff();
+
+    // Writes already queued on the ring may still land after that broadcast: cancel what
+    // the kernel hasn't taken, wait out the rest, then cut the outputs once more
+    if (ring_) {
+        ring_->halt();
+        ok = allOff() && ok;
+    }
+    return ok;
+}
+
+bool PCA9685::clearEmergencyStop() {
+    estop_.store(false, std::memory_order_release);
+    if (ring_) {
+        ring_->resume();
+    }
+    shadowStale_.store(true, std::memory_order_release);
+    return open_;
+}
+
+bool PCA9685::homeServos(const ServoTarget *targets, size_t count, std::chrono::milliseconds duration) {
+    if (!targets || count == 0 || count > 16) {
+        return false;
+    }
+
+    uint8_t channels[16];
+    float start[16];
+    float goal[16];
+    uint16_t on[16] = {0};
+    uint16_t off[16];
+
+    for (size_t i = 0; i < count; i++) {
+        if (targets[i].channel >= 16) {
+            return false;
+        }
+        if (channelType_[targets[i].channel] != targets[i].servoType && !bindChannel(targets[i].channel, targets[i].servoType)) {
+            return false;
+        }
+        channels[i] = targets[i].channel;
+        start[i] = profiler_.position(channels[i]);
+        goal[i] = targets[i].angle;
+    }
+
+    // Fixed number of steps, so the move never takes longer than requested
+    const int steps = std::max<int>(1, duration / HOMING_STEP);
+    auto next = std::chrono::steady_clock::now();
+
+    for (int step = 1; step <= steps; step++) {
+        if (estop_.load(std::memory_order_acquire)) {
+            return false;
         }
-        
-        //currentAngle[channel] = servoAngle;
+
+        // Smoothstep easing between start and goal
+        float t = static_cast<float>(step) / steps;
+        float s = t * t * (3.0f - 2.0f * t);
+
+        for (size_t i = 0; i < count; i++) {
+            float angle = start[i] + (goal[i] - start[i]) * s;
+            off[i] = angleTicks(channels[i], toAngleQ(angle));
+        }
+
+        if (!writeChannels(channels, on, off, count)) {
+            return false;
+        }
+
+        next += HOMING_STEP;
+        std::this_thread::sleep_until(next);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        profiler_.reset(channels[i], goal[i]);
+        lastSentAngle_[channels[i]] = goal[i];
     }
-    
 
-    return setServoAngle(channel, servoType, currentAngle[channel]);
+    // Return only once the arm is really there
+    return flush();
+}
+
+bool PCA9685::writeChannels(const uint8_t *channels, const uint16_t *on, const uint16_t *off, size_t count) {
+    TRACE_SCOPE("writeChannels");
+    if (!open_ || count == 0 || estop_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    syncShadow();
+
+    // Cover the channels with contiguous auto-increment bursts
+    uint8_t lo = 15;
+    uint8_t hi = 0;
+    uint16_t requested = 0;
+    for (size_t i = 0; i < count; i++) {
+        lo = std::min(lo, channels[i]);
+        hi = std::max(hi, channels[i]);
+        requested |= (1u << channels[i]);
+    }
+
+    uint16_t newOn[16];
+    uint16_t newOff[16];
+    for (int ch = lo; ch <= hi; ch++) {
+        // Channels in the gap are rewritten with their last value
+        newOn[ch] = lastOn_[ch];
+        newOff[ch] = lastOff_[ch];
+    }
+    for (size_t i = 0; i < count; i++) {
+        newOn[channels[i]] = on[i];
+        newOff[channels[i]] = off[i];
+    }
+
+    // A gap channel we hold no value for can't be rewritten without guessing one (full-off
+    // would drop a holding joint), so the burst splits around it. Normally that is one burst:
+    // one message, one STOP, and with MODE2 OCH cleared every channel latches together
+    bool ok = true;
+    int ch = lo;
+    while (ch <= hi) {
+        if (!(requested & (1u << ch)) && lastOff_[ch] == 0xFFFF) {
+            ch++;
+            continue;
+        }
+        const int first = ch;
+        while (ch <= hi && ((requested & (1u << ch)) || lastOff_[ch] != 0xFFFF)) {
+            ch++;
+        }
+
+        uint8_t data[64];
+        size_t len = 0;
+        for (int c = first; c < ch; c++) {
+            data[len++] = (uint8_t)(newOn[c] & 0xFF);
+            data[len++] = (uint8_t)((newOn[c] >> 8) & 0x1F);
+            data[len++] = (uint8_t)(newOff[c] & 0xFF);
+            data[len++] = (uint8_t)((newOff[c] >> 8) & 0x1F);
+        }
+
+        // Registers are unknown after a failed write: resend them next frame, hysteresis included
+        if (!sendBlock(LED0_ON_L + 4 * first, data, len)) {
+            for (int c = first; c < ch; c++) {
+                lastOn_[c] = 0xFFFF;
+                lastOff_[c] = 0xFFFF;
+                lastSentAngle_[c] = NAN;
+            }
+            ok = false;
+            continue;
+        }
+
+        for (int c = first; c < ch; c++) {
+            lastOn_[c] = newOn[c];
+            lastOff_[c] = newOff[c];
+        }
+        busWrites_.fetch_add(1, std::memory_order_relaxed);
+
+        // E-stop raised (e.g. from the input thread) while this burst was in flight: it may
+        // have landed after the ALL_LED broadcast, cut the outputs again
+        if (estop_.load(std::memory_order_acquire)) {
+            allOff();
+            return false;
+        }
+    }
+
+    if (ok) {
+        channelWrites_.fetch_add(count, std::memory_order_relaxed);
+    }
+    return ok;
+}
+
+void PCA9685::syncShadow() {
+    // A broadcast write touched every channel, forget what we think they hold
+    if (shadowStale_.exchange(false, std::memory_order_acquire)) {
+        for (int i = 0; i < 16; i++) {
+            lastOn_[i] = 0xFFFF;
+            lastOff_[i] = 0xFFFF;
+            lastSentAngle_[i] = NAN;
+        }
+        stagedMask_ = 0;
+    }
+}
+
+void PCA9685::beginUpdate() {
+    staging_ = true;
+    stagedMask_ = 0;
+}
+
+bool PCA9685::commitUpdate() {
+    staging_ = false;
+    if (stagedMask_ == 0) {
+        return true;
+    }
+
+    uint8_t channels[16];
+    uint16_t on[16];
+    uint16_t off[16];
+    size_t count = 0;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        if (stagedMask_ & (1u << ch)) {
+            channels[count] = ch;
+            on[count] = stagedOn_[ch];
+            off[count] = stagedOff_[ch];
+            count++;
+        }
+    }
+
+    stagedMask_ = 0;
+    return writeChannels(channels, on, off, count);
+}
+
+BusStats PCA9685::getBusStats() const {
+    BusStats stats = {
+        transactions_.load(std::memory_order_relaxed),
+        bytes_.load(std::memory_order_relaxed),
+        errors_.load(std::memory_order_relaxed),
+        retries_.load(std::memory_order_relaxed),
+        failures_.load(std::memory_order_relaxed),
+        {},
+    };
+    for (size_t i = 0; i < BUS_ERRNO_SLOTS; i++) {
+        stats.errnoCounts[i] = errnoCounts_[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+const char *PCA9685::busErrnoName(size_t slot) {
+    static const char *const names[BUS_ERRNO_SLOTS] = {"EREMOTEIO", "EIO", "ETIMEDOUT", "EAGAIN", "ENXIO", "other"};
+    return slot < BUS_ERRNO_SLOTS ? names[slot] : "";
+}
+
+bool PCA9685::flush() {
+    TRACE_SCOPE("PCA9685::flush");
+    return !ring_ || ring_->drain();
+}
+
+bool PCA9685::transfer(I2CTransaction &txn) {
+    TRACE_SCOPE("I2C_RDWR");
+    using clock = std::chrono::steady_clock;
+
+    // Blocking access must not overtake channel writes still queued on the ring
+    flush();
+
+    const auto start = clock::now();
+    const auto limit = std::min(start + retry_.budget, deadline_);
+    auto backoff = retry_.initialBackoff;
+
+    for (int attempt = 1; ; attempt++) {
+        const auto t0 = clock::now();
+        const bool ok = backend_ ? txn.submit(*backend_) : txn.submit(fd_);
+        const int err = errno;
+        const auto t1 = clock::now();
+
+        latency_.record(t1 - t0);
+        transactions_.fetch_add(1, std::memory_order_relaxed);
+        if (ok) {
+            bytes_.fetch_add(txn.byteCount(), std::memory_order_relaxed);
+            return true;
+        }
+
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        errnoCounts_[errnoSlot(err)].fetch_add(1, std::memory_order_relaxed);
+
+        // Give up rather than push the caller past its budget
+        if (attempt >= retry_.maxAttempts || !transientError(err) || t1 + backoff >= limit) {
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            errno = err;
+            return false;
+        }
+
+        retries_.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::sleep_for(backoff);
+        backoff *= 2;
+    }
 }
 
 bool PCA9685::write8(uint8_t reg, uint8_t value) {
-    uint8_t buffer[2] = {reg, value};
-    return ::write(fd_, buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer));
+    I2CTransaction txn(address_);
+    return txn.write8(reg, value) && transfer(txn);
 }
 
 bool PCA9685::writeBlock(uint8_t reg, const uint8_t *data, size_t len) {
+    TRACE_SCOPE("i2c write");
     if (!data || len == 0) {
         return false;
     }
 
-    std::vector<uint8_t> buffer(len + 1);
-    buffer[0] = reg;
-    std::memcpy(buffer.data() + 1, data, len);
-    return ::write(fd_, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+    I2CTransaction txn(address_);
+    return txn.write(reg, data, len) && transfer(txn);
 }
 
-bool PCA9685::read8(uint8_t reg, uint8_t &value) {
-    if (::write(fd_, &reg, 1) != 1) {
-        return false;
+bool PCA9685::sendBlock(uint8_t reg, const uint8_t *data, size_t len) {
+    if (!ring_ || backend_) {
+        return writeBlock(reg, data, len);
     }
 
-    if (::read(fd_, &value, 1) != 1) {
+    // Plain i2c-dev write(): one message, register pointer then payload, one STOP
+    uint8_t msg[I2CUring::MAX_WRITE];
+    if (!data || len == 0 || len + 1 > sizeof(msg)) {
         return false;
     }
+    msg[0] = reg;
+    std::memcpy(msg + 1, data, len);
+    return ring_->queueWrite(fd_, msg, len + 1, this);
+}
+
+void PCA9685::writeCompleted(int result, size_t len, std::chrono::nanoseconds latency) {
+    // Same accounting as one transfer() attempt. Nothing retries it: the stale shadow
+    // makes the next frame resend
+    latency_.record(latency);
+    transactions_.fetch_add(1, std::memory_order_relaxed);
+    if (result == static_cast<int>(len)) {
+        bytes_.fetch_add(len, std::memory_order_relaxed);
+        return;
+    }
 
-    return true;
+    // A short write counts as EIO
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    errnoCounts_[errnoSlot(result < 0 ? -result : EIO)].fetch_add(1, std::memory_order_relaxed);
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    shadowStale_.store(true, std::memory_order_release);
+}
+
+void PCA9685::writeDropped() {
+    shadowStale_.store(true, std::memory_order_release);
+}
+
+bool PCA9685::read8(uint8_t reg, uint8_t &value) {
+    // Register pointer write + repeated-start read: one syscall, no STOP in between
+    I2CTransaction txn(address_);
+    return txn.read(reg, &value, 1) && transfer(txn);
 }
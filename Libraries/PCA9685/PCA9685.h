@@ -1,31 +1,212 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
-class PCA9685 {
+#include "I2CUring.h"
+#include "ServoProfiles.h"
+#include "../Motion_Profiler/Motion_Profiler.h"
+#include "../Histogram/Histogram.h"
+
+class I2CTransaction;
+class I2CBackend;
+
+struct ServoTarget {
+    uint8_t channel;
+    uint8_t servoType;
+    float angle;
+};
+
+// Output write accounting, counts are per channel update unless noted
+struct OutputStats {
+    uint64_t updates;           // Channel values handed to setPWM
+    uint64_t hysteresisSkips;   // Dropped by the angle deadband before reaching setPWM
+    uint64_t shadowSkips;       // Dropped because the registers already hold the value
+    uint64_t channelWrites;     // Channel values that went out on the bus
+    uint64_t busWrites;         // Bus transactions carrying channel data
+};
+
+// Retries stop at whichever comes first: attempts, the per-transaction budget or the tick deadline
+struct RetryPolicy {
+    int maxAttempts;
+    std::chrono::microseconds initialBackoff;   // Doubles after every failed attempt
+    std::chrono::microseconds budget;           // Per transaction, including backoff
+};
+
+constexpr size_t BUS_ERRNO_SLOTS = 6;
+
+struct BusStats {
+    uint64_t transactions;      // ioctl attempts, retries included
+    uint64_t bytes;             // Bytes moved by successful transactions
+    uint64_t errors;            // Failed attempts
+    uint64_t retries;
+    uint64_t failures;          // Transactions that failed after all retries
+    uint64_t errnoCounts[BUS_ERRNO_SLOTS];
+};
+
+class PCA9685 : private I2CCompletionSink {
 public:
-    explicit PCA9685(uint8_t address = 0x40, std::string i2c_device = "/dev/i2c-1");
+    // Cold: reprogram the chip and start with every channel off.
+    // Warm: if the chip is still running at our frame rate, keep its outputs and
+    // adopt them as the current state (falls back to Cold otherwise)
+    enum class StartMode { Cold, Warm };
+
+    explicit PCA9685(uint8_t address = 0x40, std::string i2c_device = "/dev/i2c-1", float pwm_freq_hz = NOMINAL_PWM_FREQ_HZ);
     ~PCA9685();
 
-    bool open();
+    bool open(StartMode mode = StartMode::Cold);
     void close();
+    bool isOpen() const { return open_; }
+
+    // Send all bus traffic to backend instead of i2c_device (emulator, benchmarks). Set before open()
+    void setBackend(I2CBackend *backend) { backend_ = backend; }
     bool sleep();
     bool reset();
 
     bool setPWMFreq(float freq_hz);
+    float getPWMFreq() const { return current_freq_hz_; }   // Actual rate from the prescaler
+    float getRequestedPWMFreq() const { return requested_freq_hz_; }
+    uint8_t getPrescale() const { return prescale_; }
     bool setPWM(uint8_t channel, uint16_t on, uint16_t off);
     bool setServoPulse(uint8_t channel, float pulse_ms);
-    bool setServoAngle(uint8_t channel, uint8_t servoType, uint16_t servoAngle);
-    bool setSmoothServoAngle(uint8_t channel, uint8_t servoType, uint16_t servoAngle, float smoothness = 1);
+    bool setServoAngle(uint8_t channel, uint8_t servoType, float servoAngle);
+    bool setSmoothServoAngle(uint8_t channel, uint8_t servoType, float servoAngle, float smoothness = 1);
+
+    // Whole-arm setSmoothServoAngle: targets/smoothness for all 16 channels, bit n of mask
+    // drives channel n (servo type from setServoType). Deadband, profiling, limits,
+    // hysteresis and tick lookup run over all lanes at once; changes go out as one burst
+    bool updateJoints(const float *targets, const float *smoothness, uint16_t mask);
+
+    // Per-channel calibration, points are (commanded, output) angle pairs. count = 0 clears it
+    bool setAngleCorrection(uint8_t channel, const AngleCorrectionPoint *points, size_t count);
+
+    MotionProfiler &profiler() { return profiler_; }
+
+    // Declare a channel's servo up front, so a warm open can turn its pulse back into an angle
+    bool setServoType(uint8_t channel, uint8_t servoType);
+    uint16_t adoptedChannels() const { return adopted_; }   // Bit n: channel n resumed from the chip
+
+    // Resume the profiler from persisted angles (bit n of mask marks angles[n]). A
+    // saved angle only replaces an adopted one if it produces the same pulse
+    bool resumeFrom(const float *angles, uint16_t mask);
+
+    // Smoothed output only moves once it is this many degrees away from what was last sent
+    bool setHysteresis(uint8_t channel, float degrees);
+    OutputStats getOutputStats() const;
+
+    // Bus health
+    void setRetryPolicy(const RetryPolicy &policy) { retry_ = policy; }
+    void setDeadline(std::chrono::steady_clock::time_point deadline) { deadline_ = deadline; }
+    void clearDeadline() { deadline_ = std::chrono::steady_clock::time_point::max(); }
+    BusStats getBusStats() const;
+    const LatencyHistogram &busLatency() const { return latency_; }
+    static const char *busErrnoName(size_t slot);
+
+    // Asynchronous transport: channel writes are queued on the ring instead of blocking
+    // on the bus; a failed completion marks the register shadow stale so the frame is resent.
+    // Completions count in the bus stats and latency like blocking transfers, without retries.
+    // Register reads and configuration stay on the blocking path, after draining the ring
+    void setTransport(I2CUring *ring) { ring_ = ring; }
+    I2CUring *transport() const { return ring_; }
+    bool flush();   // Wait for queued writes to reach the bus
+
+    // Staged mode: setPWM (and everything above it) only collects changes until
+    // commitUpdate() sends them as one burst, so the group latches in the same PWM cycle
+    void beginUpdate();
+    bool commitUpdate();
+
+    // Async-signal-safe: one ALL_LED write, no locks or allocation
+    bool allOff();
+    // Also async-signal-safe; with a ring attached, waits up to ~50 ms for its writes to clear
+    bool emergencyStop();
+    bool clearEmergencyStop();
+    bool emergencyStopped() const { return estop_.load(std::memory_order_relaxed); }
+
+    // Bounded-time move of a group of servos, every step latches all channels in one burst
+    bool homeServos(const ServoTarget *targets, size_t count, std::chrono::milliseconds duration);
 
 private:
+    bool bindChannel(uint8_t channel, uint8_t servoType);
+    bool frequencySupported(float freq_hz, float actual_hz) const;
+    static bool profileSupports(uint8_t servoType, float freq_hz);
+    void rebuildTickTables();
+    bool warmAttach(uint8_t mode1);
+    float ticksToAngle(uint8_t channel, uint16_t off) const;
+    uint16_t angleTicks(uint8_t channel, int32_t angleQ) const {
+        return tickTable_[channel][std::clamp(angleQ, int32_t{0}, tickTableMax_[channel])];
+    }
+
+    bool writeChannels(const uint8_t *channels, const uint16_t *on, const uint16_t *off, size_t count);
+    void syncShadow();
+    uint16_t pulseToTicks(float pulse_ms) const;
+
+    bool transfer(I2CTransaction &txn);
     bool write8(uint8_t reg, uint8_t value);
     bool writeBlock(uint8_t reg, const uint8_t *data, size_t len);
+    bool sendBlock(uint8_t reg, const uint8_t *data, size_t len);
     bool read8(uint8_t reg, uint8_t &value);
 
+    // Ring completions for writes queued by sendBlock()
+    void writeCompleted(int result, size_t len, std::chrono::nanoseconds latency) override;
+    void writeDropped() override;
+
     int fd_;
+    bool open_;
+    I2CBackend *backend_;
     uint8_t address_;
     std::string i2c_device_;
+    float requested_freq_hz_;
     float current_freq_hz_;
+    uint8_t prescale_;
+
+    // Register shadow used to skip redundant writes
+    uint16_t lastOn_[16];
+    uint16_t lastOff_[16];
+    std::atomic<bool> shadowStale_;
+    std::atomic<bool> estop_;
+
+    // Changes collected between beginUpdate() and commitUpdate()
+    bool staging_;
+    uint16_t stagedMask_;
+    uint16_t stagedOn_[16];
+    uint16_t stagedOff_[16];
+
+    // Angle -> OFF tick lookup per channel, bound on first use of a servo type
+    const uint16_t *tickTable_[16];
+    int32_t tickTableMax_[16];
+    uint8_t channelType_[16];
+    std::vector<uint16_t> profileTicks_[SERVO_PROFILE_COUNT];  // Only used when not at 50 Hz
+    std::vector<AngleCorrectionPoint> correction_[16];
+    std::vector<uint16_t> correctedTicks_[16];
+
+    // Smoothing state per channel
+    MotionProfiler profiler_;
+    float hysteresis_[16];
+    float lastSentAngle_[16];
+    alignas(64) float limitLo_[16];     // Angle range of the bound servo, 0..0 when unbound
+    alignas(64) float limitHi_[16];
+    uint16_t adopted_;
+
+    std::atomic<uint64_t> updates_;
+    std::atomic<uint64_t> hysteresisSkips_;
+    std::atomic<uint64_t> shadowSkips_;
+    std::atomic<uint64_t> channelWrites_;
+    std::atomic<uint64_t> busWrites_;
+
+    I2CUring *ring_;
+
+    // Bus accounting and retry state
+    RetryPolicy retry_;
+    std::chrono::steady_clock::time_point deadline_;
+    LatencyHistogram latency_;
+    std::atomic<uint64_t> transactions_;
+    std::atomic<uint64_t> bytes_;
+    std::atomic<uint64_t> errors_;
+    std::atomic<uint64_t> retries_;
+    std::atomic<uint64_t> failures_;
+    std::atomic<uint64_t> errnoCounts_[BUS_ERRNO_SLOTS];
 };
@@ -0,0 +1,146 @@
+#include "PCA9685Emulator.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace {
+constexpr uint8_t MODE1 = 0x00;
+constexpr uint8_t MODE2 = 0x01;
+constexpr uint8_t LED0_ON_L = 0x06;
+constexpr uint8_t LED15_OFF_H = 0x45;
+constexpr uint8_t ALL_LED_ON_L = 0xFA;
+constexpr uint8_t ALL_LED_OFF_H = 0xFD;
+constexpr uint8_t PRESCALE = 0xFE;
+constexpr uint8_t MODE1_RESTART = 0x80;
+constexpr uint8_t MODE1_AI = 0x20;
+constexpr uint8_t MODE1_SLEEP = 0x10;
+
+// START + address byte + STOP, in bit times; every data byte is 9 (ACK included)
+constexpr uint32_t FRAME_BITS = 1 + 9 + 1;
+constexpr uint32_t BYTE_BITS = 9;
+}
+
+PCA9685Emulator::PCA9685Emulator(uint32_t busClockHz) : busClockHz_(busClockHz), transfers_(0) {}
+
+bool PCA9685Emulator::addDevice(uint8_t address) {
+    if (find(address)) {
+        return false;
+    }
+
+    // Power-on state: asleep, auto-increment off, all channels full-off, ~200 Hz
+    Chip chip{};
+    chip.address = address;
+    chip.regs[MODE1] = MODE1_SLEEP;
+    chip.regs[MODE2] = 0x04;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        chip.regs[LED0_ON_L + 4 * ch + 3] = 0x10;
+    }
+    chip.regs[PRESCALE] = 0x1E;
+    chips_.push_back(chip);
+    return true;
+}
+
+bool PCA9685Emulator::transfer(i2c_msg *msgs, size_t count) {
+    const auto start = std::chrono::steady_clock::now();
+    transfers_++;
+
+    uint64_t bits = 1;  // Final STOP
+    bool ok = true;
+    for (size_t m = 0; m < count && ok; m++) {
+        i2c_msg &msg = msgs[m];
+        bits += FRAME_BITS - 1 + static_cast<uint64_t>(msg.len) * BYTE_BITS;
+
+        Chip *chip = find(msg.addr);
+        if (!chip) {
+            errno = EREMOTEIO;  // Address NACK
+            ok = false;
+            break;
+        }
+
+        if (msg.flags & I2C_M_RD) {
+            for (uint16_t i = 0; i < msg.len; i++) {
+                msg.buf[i] = chip->regs[chip->pointer];
+                advance(*chip);
+            }
+        } else if (msg.len > 0) {
+            chip->pointer = msg.buf[0];
+            for (uint16_t i = 1; i < msg.len; i++) {
+                writeReg(*chip, chip->pointer, msg.buf[i]);
+                advance(*chip);
+            }
+        }
+    }
+
+    // Hold the caller for as long as the real wire would
+    if (busClockHz_ > 0) {
+        const auto wire = std::chrono::nanoseconds(bits * 1000000000ull / busClockHz_);
+        while (std::chrono::steady_clock::now() - start < wire) {
+        }
+    }
+    return ok;
+}
+
+uint8_t PCA9685Emulator::reg(uint8_t address, uint8_t reg) const {
+    const Chip *chip = find(address);
+    return chip ? chip->regs[reg] : 0;
+}
+
+uint16_t PCA9685Emulator::offTicks(uint8_t address, uint8_t channel) const {
+    const Chip *chip = find(address);
+    if (!chip || channel >= 16) {
+        return 0;
+    }
+    const uint8_t *r = chip->regs + LED0_ON_L + 4 * channel;
+    return static_cast<uint16_t>(r[2] | ((r[3] & 0x1F) << 8));
+}
+
+PCA9685Emulator::Chip *PCA9685Emulator::find(uint16_t address) {
+    for (Chip &chip : chips_) {
+        if (chip.address == address) {
+            return &chip;
+        }
+    }
+    return nullptr;
+}
+
+const PCA9685Emulator::Chip *PCA9685Emulator::find(uint16_t address) const {
+    return const_cast<PCA9685Emulator *>(this)->find(address);
+}
+
+void PCA9685Emulator::writeReg(Chip &chip, uint8_t reg, uint8_t value) {
+    switch (reg) {
+        case MODE1:
+            chip.regs[MODE1] = value & ~MODE1_RESTART;     // RESTART reads back cleared once acted on
+            return;
+        case PRESCALE:
+            if (chip.regs[MODE1] & MODE1_SLEEP) {
+                chip.regs[PRESCALE] = value;
+            }
+            return;
+        default:
+            break;
+    }
+
+    chip.regs[reg] = value;
+
+    // ALL_LED registers write through to the same register of every channel
+    if (reg >= ALL_LED_ON_L && reg <= ALL_LED_OFF_H) {
+        for (uint8_t ch = 0; ch < 16; ch++) {
+            chip.regs[LED0_ON_L + 4 * ch + (reg - ALL_LED_ON_L)] = value;
+        }
+    }
+}
+
+void PCA9685Emulator::advance(Chip &chip) {
+    if (!(chip.regs[MODE1] & MODE1_AI)) {
+        return;
+    }
+
+    // Auto-increment runs through the LED block and wraps back to MODE1
+    if (chip.pointer == LED15_OFF_H || chip.pointer == 0xFF) {
+        chip.pointer = MODE1;
+    } else {
+        chip.pointer++;
+    }
+}
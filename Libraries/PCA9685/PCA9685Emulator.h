@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "I2CTransaction.h"
+
+// In-process I2C bus with PCA9685s on it, for benchmarks and running without
+// hardware. Keeps each chip's register file (auto-increment, PRESCALE only
+// writable in sleep, ALL_LED broadcast) and can charge the wire time the real
+// bus would take at busClockHz, so throughput numbers stay comparable.
+class PCA9685Emulator : public I2CBackend {
+public:
+    explicit PCA9685Emulator(uint32_t busClockHz = 0);     // 0: software cost only
+
+    bool addDevice(uint8_t address);
+    bool transfer(i2c_msg *msgs, size_t count) override;
+
+    uint8_t reg(uint8_t address, uint8_t reg) const;
+    uint16_t offTicks(uint8_t address, uint8_t channel) const;
+    uint64_t transfers() const { return transfers_; }
+
+private:
+    struct Chip {
+        uint8_t address;
+        uint8_t pointer;
+        uint8_t regs[256];
+    };
+
+    Chip *find(uint16_t address);
+    const Chip *find(uint16_t address) const;
+    void writeReg(Chip &chip, uint8_t reg, uint8_t value);
+    void advance(Chip &chip);
+
+    std::vector<Chip> chips_;
+    uint32_t busClockHz_;
+    uint64_t transfers_;
+};
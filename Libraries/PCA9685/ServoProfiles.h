@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Angles are fixed-point with ANGLE_FRAC_BITS fractional bits (1/16 degree)
+constexpr int ANGLE_FRAC_BITS = 4;
+constexpr int32_t ANGLE_ONE = 1 << ANGLE_FRAC_BITS;
+
+constexpr int32_t toAngleQ(float degrees) {
+    return static_cast<int32_t>(degrees * ANGLE_ONE + (degrees >= 0.0f ? 0.5f : -0.5f));
+}
+
+constexpr float fromAngleQ(int32_t q) {
+    return static_cast<float>(q) / ANGLE_ONE;
+}
+
+struct ServoProfile {
+    float minPulseMs;
+    float maxPulseMs;
+    uint16_t minAngle;   // Angle at minPulseMs, anything below is clamped
+    uint16_t maxAngle;   // Angle at maxPulseMs, anything above is clamped
+    float maxFreqHz;     // Highest frame rate the servo accepts
+};
+
+// Indexed by servo type (MS62_SERVO, DM996_SERVO, MS62_SERVO_A)
+constexpr ServoProfile SERVO_PROFILES[] = {
+    {0.5f,   2.5f,   0,  270, 330.0f},  // MS62: 25kg servo motor
+    {0.5f,   2.5f,   0,  180, 300.0f},  // DM996: 15kg servo motor
+    {0.611f, 2.322f, 15, 246, 330.0f},  // MS62_A: special case, calibrated 15-246 degree window
+};
+constexpr size_t SERVO_PROFILE_COUNT = sizeof(SERVO_PROFILES) / sizeof(SERVO_PROFILES[0]);
+
+constexpr float OSC_CLOCK_HZ = 25000000.0f;
+constexpr uint16_t PWM_RESOLUTION = 4096;
+constexpr uint8_t MIN_PRESCALE = 3;     // Hardware minimum, ~1526 Hz
+
+constexpr uint8_t prescaleFor(float freq_hz) {
+    float prescale = OSC_CLOCK_HZ / (PWM_RESOLUTION * freq_hz) - 1.0f;
+    if (prescale < MIN_PRESCALE) prescale = MIN_PRESCALE;
+    if (prescale > 255.0f) prescale = 255.0f;
+    return static_cast<uint8_t>(prescale + 0.5f);
+}
+
+// Frame rate the chip actually produces for a prescaler value
+constexpr float prescaleFreq(uint8_t prescale) {
+    return OSC_CLOCK_HZ / (PWM_RESOLUTION * (prescale + 1.0f));
+}
+
+constexpr float NOMINAL_PWM_FREQ_HZ = 50.0f;
+constexpr float DEFAULT_PWM_FREQ_HZ = prescaleFreq(prescaleFor(NOMINAL_PWM_FREQ_HZ));   // 50.03 Hz
+
+// Table index covers 0..maxAngle in 1/16 degree steps
+constexpr size_t tickTableSize(const ServoProfile &profile) {
+    return (static_cast<size_t>(profile.maxAngle) << ANGLE_FRAC_BITS) + 1;
+}
+
+// Same math as map() + constrain() + setServoPulse(), without the float round-trip at runtime
+constexpr uint16_t angleToTick(const ServoProfile &profile, float degrees, float freq_hz) {
+    float pulse = profile.minPulseMs + (degrees - profile.minAngle) * (profile.maxPulseMs - profile.minPulseMs) /
+                                       (profile.maxAngle - profile.minAngle);
+    if (pulse < profile.minPulseMs) pulse = profile.minPulseMs;
+    if (pulse > profile.maxPulseMs) pulse = profile.maxPulseMs;
+
+    float ticks = pulse * freq_hz * PWM_RESOLUTION / 1000.0f;
+    if (ticks < 0.0f) ticks = 0.0f;
+    if (ticks > PWM_RESOLUTION - 1) ticks = PWM_RESOLUTION - 1;
+    return static_cast<uint16_t>(ticks + 0.5f);
+}
+
+template <size_t N>
+constexpr std::array<uint16_t, N> makeTickTable(const ServoProfile &profile, float freq_hz) {
+    std::array<uint16_t, N> table{};
+    for (size_t i = 0; i < N; i++) {
+        table[i] = angleToTick(profile, fromAngleQ(static_cast<int32_t>(i)), freq_hz);
+    }
+    return table;
+}
+
+// Compile-time tables for the default 50 Hz frame (at the frequency the prescaler really gives)
+inline constexpr auto MS62_TICKS_50HZ =
+    makeTickTable<tickTableSize(SERVO_PROFILES[0])>(SERVO_PROFILES[0], DEFAULT_PWM_FREQ_HZ);
+inline constexpr auto DM996_TICKS_50HZ =
+    makeTickTable<tickTableSize(SERVO_PROFILES[1])>(SERVO_PROFILES[1], DEFAULT_PWM_FREQ_HZ);
+inline constexpr auto MS62_A_TICKS_50HZ =
+    makeTickTable<tickTableSize(SERVO_PROFILES[2])>(SERVO_PROFILES[2], DEFAULT_PWM_FREQ_HZ);
+
+inline constexpr const uint16_t *DEFAULT_TICK_TABLES[SERVO_PROFILE_COUNT] = {
+    MS62_TICKS_50HZ.data(),
+    DM996_TICKS_50HZ.data(),
+    MS62_A_TICKS_50HZ.data(),
+};
+
+// Piecewise-linear calibration point: the servo should be driven to `output`
+// when `commanded` is requested
+struct AngleCorrectionPoint {
+    float commanded;
+    float output;
+};
@@ -0,0 +1,156 @@
+#include "Perf_Counters.h"
+
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+struct CounterSpec {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+};
+
+const CounterSpec COUNTER_SPECS[PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     "cache misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,    "branch misses"},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "context switches"},
+};
+
+int perfEventOpen(perf_event_attr &attr, int groupFd) {
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+// Group read layout: nr, time enabled, time running, then one value per counter
+struct GroupRead {
+    uint64_t nr;
+    uint64_t enabled;
+    uint64_t running;
+    uint64_t values[PERF_COUNTERS];
+};
+}
+
+PerfCounters::PerfCounters() : leader_(-1), opened_(0) {
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        fds_[i] = -1;
+        slot_[i] = 0;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+bool PerfCounters::open() {
+    if (available()) {
+        return true;
+    }
+
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = COUNTER_SPECS[i].type;
+        attr.config = COUNTER_SPECS[i].config;
+        attr.disabled = leader_ < 0;    // Leader starts the whole group
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // Context switches happen in the kernel, the rest is about our own user-space code.
+        // Unprivileged (perf_event_paranoid 2) only allows user-space counting
+        attr.exclude_kernel = COUNTER_SPECS[i].type == PERF_TYPE_HARDWARE;
+        int fd = perfEventOpen(attr, leader_);
+        if (fd < 0 && !attr.exclude_kernel) {
+            attr.exclude_kernel = 1;
+            fd = perfEventOpen(attr, leader_);
+        }
+        if (fd < 0) {
+            continue;
+        }
+
+        fds_[i] = fd;
+        slot_[i] = opened_++;
+        if (leader_ < 0) {
+            leader_ = fd;
+        }
+    }
+
+    if (!available()) {
+        return false;
+    }
+
+    ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounters::close() {
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        if (fds_[i] >= 0) {
+            ::close(fds_[i]);
+            fds_[i] = -1;
+        }
+    }
+    leader_ = -1;
+    opened_ = 0;
+}
+
+bool PerfCounters::read(PerfSample &sample) const {
+    std::memset(&sample, 0, sizeof(sample));
+    if (!available()) {
+        return false;
+    }
+
+    GroupRead group;
+    const ssize_t expected = static_cast<ssize_t>((3 + opened_) * sizeof(uint64_t));
+    if (::read(leader_, &group, sizeof(group)) < expected || group.nr != opened_) {
+        return false;
+    }
+
+    // The PMU was shared with other events for part of the time: scale up to the full interval
+    const bool scaled = group.running > 0 && group.running < group.enabled;
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        if (fds_[i] < 0) {
+            continue;
+        }
+        uint64_t value = group.values[slot_[i]];
+        if (scaled) {
+            value = static_cast<uint64_t>(static_cast<double>(value) * group.enabled / group.running);
+        }
+        sample.values[i] = value;
+    }
+    return true;
+}
+
+const char *PerfCounters::name(PerfCounter counter) {
+    return counter < PERF_COUNTERS ? COUNTER_SPECS[counter].name : "unknown";
+}
+
+PerfStage::PerfStage() : count_(0) {
+    for (auto &total : totals_) {
+        total.store(0, std::memory_order_relaxed);
+    }
+}
+
+void PerfStage::add(const PerfSample &begin, const PerfSample &end) {
+    for (size_t i = 0; i < PERF_COUNTERS; i++) {
+        if (end.values[i] >= begin.values[i]) {
+            totals_[i].fetch_add(end.values[i] - begin.values[i], std::memory_order_relaxed);
+        }
+    }
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+double PerfStage::perCall(PerfCounter counter) const {
+    const uint64_t n = count();
+    return n ? static_cast<double>(total(counter)) / n : 0.0;
+}
+
+double PerfStage::ipc() const {
+    const uint64_t cycles = total(PERF_CYCLES);
+    return cycles ? static_cast<double>(total(PERF_INSTRUCTIONS)) / cycles : 0.0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum PerfCounter : size_t {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_CONTEXT_SWITCHES,
+    PERF_COUNTERS
+};
+
+// Counter values at one point in time; counters that could not be opened read 0
+struct PerfSample {
+    uint64_t values[PERF_COUNTERS];
+};
+
+// Hardware and scheduler counters for the calling thread through perf_event_open.
+// All counters sit in one group, so read() is a single syscall. Whatever the
+// kernel refuses (perf_event_paranoid, no PMU in a VM) is left out and reads 0
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool open();    // For the calling thread, false if no counter is available
+    void close();
+
+    bool available() const { return leader_ >= 0; }
+    bool has(PerfCounter counter) const { return fds_[counter] >= 0; }
+
+    bool read(PerfSample &sample) const;
+
+    static const char *name(PerfCounter counter);
+
+private:
+    int leader_;
+    int fds_[PERF_COUNTERS];
+    size_t slot_[PERF_COUNTERS];    // Position of each counter in the group read
+    size_t opened_;
+};
+
+// Running totals of counter deltas for one pipeline stage. add() is called
+// by the measured thread, the totals can be read from anywhere
+class PerfStage {
+public:
+    PerfStage();
+
+    void add(const PerfSample &begin, const PerfSample &end);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t total(PerfCounter counter) const { return totals_[counter].load(std::memory_order_relaxed); }
+    double perCall(PerfCounter counter) const;
+    double ipc() const;     // Instructions per cycle, 0 without both counters
+
+private:
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> totals_[PERF_COUNTERS];
+};
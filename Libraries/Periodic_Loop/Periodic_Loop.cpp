@@ -0,0 +1,82 @@
+#include "Periodic_Loop.h"
+#include "../Trace/Trace.h"
+
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+constexpr int64_t NS_PER_S = 1000000000;
+
+int64_t toNs(const timespec &ts) {
+    return static_cast<int64_t>(ts.tv_sec) * NS_PER_S + ts.tv_nsec;
+}
+
+timespec fromNs(int64_t ns) {
+    return {static_cast<time_t>(ns / NS_PER_S), static_cast<long>(ns % NS_PER_S)};
+}
+
+timespec now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts;
+}
+}
+
+PeriodicLoop::PeriodicLoop(double rateHz)
+    : rateHz_(rateHz), periodNs_(static_cast<int64_t>(NS_PER_S / rateHz)), deadline_{}, lastWake_{}, started_(false),
+      ticks_(0), overruns_(0) {}
+
+bool PeriodicLoop::setRealtime(int priority) {
+    sched_param param{};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+bool PeriodicLoop::setAffinity(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+float PeriodicLoop::next() {
+    // First call anchors the grid and doesn't wait
+    if (!started_) {
+        started_ = true;
+        lastWake_ = now();
+        deadline_ = lastWake_;
+        return 1.0f / static_cast<float>(rateHz_);
+    }
+
+    const int64_t doneNs = toNs(now());
+    compute_.record(std::chrono::nanoseconds(doneNs - toNs(lastWake_)));
+
+    // Already past the next deadline: skip to the first one still ahead
+    int64_t deadlineNs = toNs(deadline_) + periodNs_;
+    if (doneNs >= deadlineNs) {
+        const int64_t skipped = (doneNs - deadlineNs) / periodNs_ + 1;
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        deadlineNs += skipped * periodNs_;
+    }
+    deadline_ = fromNs(deadlineNs);
+
+    {
+        TRACE_SCOPE("sleep");
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline_, nullptr) == EINTR) {
+        }
+    }
+
+    const timespec wake = now();
+    lateness_.record(std::chrono::nanoseconds(toNs(wake) - deadlineNs));
+    period_.record(std::chrono::nanoseconds(toNs(wake) - toNs(lastWake_)));
+    ticks_.fetch_add(1, std::memory_order_relaxed);
+
+    const float dt = static_cast<float>(toNs(wake) - toNs(lastWake_)) / NS_PER_S;
+    lastWake_ = wake;
+    return dt;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#include "../Histogram/Histogram.h"
+
+// Fixed-rate loop on absolute CLOCK_MONOTONIC deadlines, so the period doesn't
+// stretch by the work done in it. Call next() at the top of every iteration.
+//
+// A tick that runs past its deadline counts as an overrun; the missed periods
+// are skipped rather than run back to back.
+class PeriodicLoop {
+public:
+    explicit PeriodicLoop(double rateHz);
+
+    // For the calling thread. Both fail without the needed privileges, the loop still runs
+    bool setRealtime(int priority);     // SCHED_FIFO, 1..99
+    bool setAffinity(int cpu);
+
+    // Sleeps until the next deadline, returns seconds since the previous wake-up
+    float next();
+
+    double rate() const { return rateHz_; }
+    uint64_t ticks() const { return ticks_.load(std::memory_order_relaxed); }
+    uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+
+    const LatencyHistogram &lateness() const { return lateness_; }   // Wake-up past the deadline
+    const LatencyHistogram &compute() const { return compute_; }     // Wake-up to the next next() call
+    const LatencyHistogram &period() const { return period_; }       // Wake-up to wake-up
+
+private:
+    double rateHz_;
+    int64_t periodNs_;
+    timespec deadline_;
+    timespec lastWake_;
+    bool started_;
+
+    std::atomic<uint64_t> ticks_;
+    std::atomic<uint64_t> overruns_;
+    LatencyHistogram lateness_;
+    LatencyHistogram compute_;
+    LatencyHistogram period_;
+};
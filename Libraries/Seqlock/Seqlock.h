@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer seqlock for a small POD snapshot. store() never waits and costs
+// one release; load() retries only if it overlapped a store, and always returns
+// a consistent copy. The payload is kept in relaxed atomic words, so concurrent
+// access is well-defined.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock payload must be trivially copyable");
+
+public:
+    Seqlock() : seq_(0), words_{} {}
+    explicit Seqlock(const T &initial) : Seqlock() { store(initial); }
+
+    void store(const T &value) {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        const uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);     // Odd: store in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            words_[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // In-process only: retries for as long as stores keep overlapping it
+    T load() const {
+        T value;
+        while (!tryLoad(value, 1)) {
+        }
+        return value;
+    }
+
+    // Gives up after attempts overlapping stores. For a writer in another process,
+    // which may die in the middle of a store and leave the sequence odd for good
+    bool tryLoad(T &value, int attempts) const {
+        uint64_t buffer[WORDS];
+        for (int n = 0; n < attempts; n++) {
+            const uint64_t before = seq_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++) {
+                buffer[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t after = seq_.load(std::memory_order_relaxed);
+            if (!(before & 1) && before == after) {
+                std::memcpy(&value, buffer, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(64) std::atomic<uint64_t> seq_;
+    std::atomic<uint64_t> words_[WORDS];
+};
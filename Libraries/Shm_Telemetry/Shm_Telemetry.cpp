@@ -0,0 +1,260 @@
+#include "Shm_Telemetry.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint32_t RECORD_WORDS = (sizeof(TickRecord) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+size_t roundUpPow2(size_t n) {
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+size_t regionSize(size_t capacity, size_t slotWords) {
+    return sizeof(ShmTelemetryHeader) + capacity * (1 + slotWords) * sizeof(uint64_t);
+}
+
+// Sequence word of a slot: odd while record n is being written, 2 * (n + 1) once it is complete
+uint64_t completeSeq(uint64_t index) {
+    return 2 * (index + 1);
+}
+}
+
+ShmTelemetryWriter::ShmTelemetryWriter(std::string name, size_t capacity)
+    : name_(std::move(name)), capacity_(roundUpPow2(capacity)), size_(regionSize(capacity_, RECORD_WORDS)),
+      header_(nullptr), slots_(nullptr) {}
+
+ShmTelemetryWriter::~ShmTelemetryWriter() {
+    close();
+}
+
+bool ShmTelemetryWriter::open() {
+    if (header_) {
+        return true;
+    }
+
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Left by a writer with another layout: resizing it in place would pull pages out from
+    // under attached readers. Retire it (they see the magic drop and reopen) and start a new one
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size != 0 && static_cast<size_t>(st.st_size) != size_) {
+        if (static_cast<size_t>(st.st_size) >= sizeof(ShmTelemetryHeader)) {
+            void *old = mmap(nullptr, sizeof(ShmTelemetryHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (old != MAP_FAILED) {
+                static_cast<ShmTelemetryHeader *>(old)->magic.store(0, std::memory_order_release);
+                munmap(old, sizeof(ShmTelemetryHeader));
+            }
+        }
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    // Readers still attached from a previous run see the magic drop, then a new session
+    header_ = static_cast<ShmTelemetryHeader *>(map);
+    slots_ = reinterpret_cast<std::atomic<uint64_t> *>(static_cast<char *>(map) + sizeof(ShmTelemetryHeader));
+    header_->magic.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header_->version = SHM_TELEMETRY_VERSION;
+    header_->recordSize = static_cast<uint16_t>(sizeof(TickRecord));
+    header_->capacity = static_cast<uint32_t>(capacity_);
+    header_->slotWords = RECORD_WORDS;
+    for (size_t i = 0; i < capacity_ * (1 + RECORD_WORDS); i++) {
+        slots_[i].store(0, std::memory_order_relaxed);
+    }
+    header_->head.store(0, std::memory_order_relaxed);
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header_->session.store((static_cast<uint64_t>(getpid()) << 32) ^ static_cast<uint64_t>(now.tv_sec) ^
+                           static_cast<uint64_t>(now.tv_nsec), std::memory_order_relaxed);
+    header_->magic.store(SHM_TELEMETRY_MAGIC, std::memory_order_release);
+    return true;
+}
+
+void ShmTelemetryWriter::close() {
+    if (header_) {
+        munmap(header_, size_);
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+}
+
+void ShmTelemetryWriter::publish(const TickRecord &record) {
+    if (!header_) {
+        return;
+    }
+
+    uint64_t words[RECORD_WORDS] = {};
+    std::memcpy(words, &record, sizeof(record));
+
+    const uint64_t index = header_->head.load(std::memory_order_relaxed);
+    std::atomic<uint64_t> *slot = slots_ + (index & (capacity_ - 1)) * (1 + RECORD_WORDS);
+
+    slot[0].store(completeSeq(index) - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < RECORD_WORDS; i++) {
+        slot[1 + i].store(words[i], std::memory_order_relaxed);
+    }
+    slot[0].store(completeSeq(index), std::memory_order_release);
+    header_->head.store(index + 1, std::memory_order_release);
+}
+
+ShmTelemetryReader::ShmTelemetryReader(std::string name)
+    : name_(std::move(name)), size_(0), header_(nullptr), slots_(nullptr), capacity_(0), slotWords_(0), following_(false),
+      session_(0), cursor_(0), lost_(0) {}
+
+ShmTelemetryReader::~ShmTelemetryReader() {
+    close();
+}
+
+bool ShmTelemetryReader::open() {
+    if (header_) {
+        return true;
+    }
+    if (!map()) {
+        return false;
+    }
+
+    following_ = true;
+    session_ = header_->session.load(std::memory_order_acquire);
+    seekLatest();
+    return true;
+}
+
+bool ShmTelemetryReader::map() {
+    const int fd = shm_open(name_.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmTelemetryHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void *region = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (region == MAP_FAILED) {
+        return false;
+    }
+
+    // Same major layout, a record at least as large as ours and a region that holds all the slots
+    const auto *header = static_cast<const ShmTelemetryHeader *>(region);
+    const bool valid = header->magic.load(std::memory_order_acquire) == SHM_TELEMETRY_MAGIC &&
+                       header->version == SHM_TELEMETRY_VERSION && header->recordSize >= sizeof(TickRecord) &&
+                       header->slotWords >= RECORD_WORDS && header->capacity > 0 &&
+                       (header->capacity & (header->capacity - 1)) == 0 &&
+                       regionSize(header->capacity, header->slotWords) <= size_;
+    if (!valid) {
+        munmap(region, size_);
+        return false;
+    }
+
+    // Slots are indexed with the layout this mapping was sized for, never the live header's
+    header_ = header;
+    slots_ = reinterpret_cast<const std::atomic<uint64_t> *>(static_cast<const char *>(region) + sizeof(ShmTelemetryHeader));
+    capacity_ = header->capacity;
+    slotWords_ = header->slotWords;
+    return true;
+}
+
+void ShmTelemetryReader::close() {
+    unmap();
+    following_ = false;
+}
+
+void ShmTelemetryReader::unmap() {
+    if (header_) {
+        munmap(const_cast<ShmTelemetryHeader *>(header_), size_);
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+}
+
+void ShmTelemetryReader::seekOldest() {
+    const uint64_t head = header_ ? header_->head.load(std::memory_order_acquire) : 0;
+    cursor_ = header_ && head > capacity_ ? head - capacity_ : 0;
+}
+
+void ShmTelemetryReader::seekLatest() {
+    cursor_ = header_ ? header_->head.load(std::memory_order_acquire) : 0;
+}
+
+bool ShmTelemetryReader::next(TickRecord &record) {
+    // Region retired or re-laid out by a new writer: map it again, once it is ready
+    if (header_ && (header_->magic.load(std::memory_order_acquire) != SHM_TELEMETRY_MAGIC ||
+                    header_->capacity != capacity_ || header_->slotWords != slotWords_)) {
+        unmap();
+    }
+    if (!header_ && !(following_ && map())) {
+        return false;
+    }
+
+    // A new writer started over: follow it from its first record
+    const uint64_t session = header_->session.load(std::memory_order_acquire);
+    if (session != session_) {
+        session_ = session;
+        cursor_ = 0;
+    }
+
+    const uint64_t capacity = capacity_;
+    const uint64_t stride = 1 + slotWords_;
+    uint64_t words[RECORD_WORDS];
+
+    while (true) {
+        const uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (cursor_ >= head) {
+            return false;
+        }
+        if (head - cursor_ > capacity) {
+            lost_ += head - cursor_ - capacity;
+            cursor_ = head - capacity;
+        }
+
+        const std::atomic<uint64_t> *slot = slots_ + (cursor_ & (capacity - 1)) * stride;
+        const uint64_t before = slot[0].load(std::memory_order_acquire);
+        for (size_t i = 0; i < RECORD_WORDS; i++) {
+            words[i] = slot[1 + i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t after = slot[0].load(std::memory_order_relaxed);
+
+        // Overwritten by a later lap before or while copying: that record is gone
+        if (before != completeSeq(cursor_) || after != before) {
+            lost_++;
+            cursor_++;
+            continue;
+        }
+
+        std::memcpy(&record, words, sizeof(record));
+        cursor_++;
+        return true;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../Tick_Log/Tick_Log.h"
+
+constexpr const char *SHM_TELEMETRY_NAME = "/6dof_telemetry";     // /dev/shm/6dof_telemetry
+constexpr uint32_t SHM_TELEMETRY_MAGIC = 0x594D4C54;                // "TLMY"
+constexpr uint16_t SHM_TELEMETRY_VERSION = 1;
+
+// Start of the shared region, followed by `capacity` slots of
+// 8 * (1 + slotWords) bytes: a sequence word, then the TickRecord as 64-bit words.
+// recordSize lets an older reader follow a writer whose TickRecord gained fields
+struct ShmTelemetryHeader {
+    std::atomic<uint32_t> magic;    // Set last, a region being initialised is never followed
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t capacity;              // Power of two
+    uint32_t slotWords;
+    std::atomic<uint64_t> session;  // Changes when a new writer takes the region over
+    alignas(64) std::atomic<uint64_t> head;     // Records published this session
+};
+
+// Per-tick records in a POSIX shared-memory ring. The writer never waits on
+// readers: publish() is a handful of relaxed stores and two releases, and old
+// records are simply overwritten. Each slot is a seqlock, so a reader that
+// gets lapped notices and skips ahead instead of returning a torn record
+class ShmTelemetryWriter {
+public:
+    explicit ShmTelemetryWriter(std::string name = SHM_TELEMETRY_NAME, size_t capacity = 1024);
+    ~ShmTelemetryWriter();
+
+    bool open();
+    void close();   // The region stays behind for readers, they pick up the next writer
+    bool isOpen() const { return header_ != nullptr; }
+
+    void publish(const TickRecord &record);
+
+private:
+    std::string name_;
+    size_t capacity_;
+    size_t size_;
+    ShmTelemetryHeader *header_;
+    std::atomic<uint64_t> *slots_;
+};
+
+// Follows the ring from another process. After open() reading is plain memory
+// access, no syscalls; any number of readers can follow the same writer
+class ShmTelemetryReader {
+public:
+    explicit ShmTelemetryReader(std::string name = SHM_TELEMETRY_NAME);
+    ~ShmTelemetryReader();
+
+    // False if there is no region yet or its layout is not understood. Once open, the
+    // reader follows later writers too, remapping when one replaces or re-lays out the region
+    bool open();
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    void seekOldest();
+    void seekLatest();
+
+    // Next record in order; false once caught up with the writer
+    bool next(TickRecord &record);
+    uint64_t lost() const { return lost_; }     // Overwritten before they could be read
+
+private:
+    bool map();
+    void unmap();
+
+    std::string name_;
+    size_t size_;
+    const ShmTelemetryHeader *header_;
+    const std::atomic<uint64_t> *slots_;
+    uint32_t capacity_;     // Layout the mapping was sized for
+    uint32_t slotWords_;
+    bool following_;
+    uint64_t session_;
+    uint64_t cursor_;
+    uint64_t lost_;
+};
@@ -0,0 +1,118 @@
+#include "Tick_Log.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t DRAIN_CHUNK = 64;  // Records per write() call
+
+size_t roundUpPow2(size_t n) {
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+bool writeAll(int fd, const void *data, size_t len) {
+    const char *ptr = static_cast<const char *>(data);
+    while (len > 0) {
+        ssize_t n = ::write(fd, ptr, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        ptr += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+}
+
+TickLog::TickLog(size_t capacity)
+    : ring_(roundUpPow2(capacity)), mask_(ring_.size() - 1), head_(0), tail_(0), dropped_(0), written_(0), fd_(-1),
+      running_(false) {}
+
+TickLog::~TickLog() {
+    stop();
+}
+
+bool TickLog::start(const std::string &path, std::chrono::milliseconds interval) {
+    if (running_.load()) {
+        return false;
+    }
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    const TickLogHeader header = {TICK_LOG_MAGIC, TICK_LOG_VERSION, static_cast<uint16_t>(sizeof(TickRecord))};
+    if (!writeAll(fd_, &header, sizeof(header))) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    running_.store(true);
+    thread_ = std::thread(&TickLog::run, this, interval);
+    return true;
+}
+
+void TickLog::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        drain();
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool TickLog::record(const TickRecord &record) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) > mask_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ring_[head & mask_] = record;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void TickLog::run(std::chrono::milliseconds interval) {
+    while (running_.load()) {
+        std::this_thread::sleep_for(interval);
+        if (!drain()) {
+            break;      // Disk trouble: the ring fills up and record() starts dropping
+        }
+    }
+}
+
+bool TickLog::drain() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+
+    // Copy out in chunks so the slots are handed back before the slow write
+    TickRecord chunk[DRAIN_CHUNK];
+    while (tail != head) {
+        size_t count = 0;
+        while (tail != head && count < DRAIN_CHUNK) {
+            chunk[count++] = ring_[tail & mask_];
+            tail++;
+        }
+        tail_.store(tail, std::memory_order_release);
+
+        if (!writeAll(fd_, chunk, count * sizeof(TickRecord))) {
+            return false;
+        }
+        written_.fetch_add(count, std::memory_order_relaxed);
+    }
+    return true;
+}
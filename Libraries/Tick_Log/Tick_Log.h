@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Perf_Counters/Perf_Counters.h"
+
+// One IK tick. Times are steady_clock nanoseconds
+struct TickRecord {
+    uint64_t tick;
+    int64_t sampledNs;      // Controller read behind this pose
+    int64_t wakeNs;         // IK thread woke up
+    int64_t solvedNs;       // IK solver returned
+    int64_t publishedNs;    // Joint targets handed to the output scheduler
+    float pose[6];          // x, y, z, roll, pitch, yaw
+    float joints[6];        // Commanded servo angles, degrees
+    int32_t ikStatus;       // KDL error code, >= 0 on success
+    int32_t ikIterations;
+    uint32_t flags;         // TICK_* bits
+    uint32_t reserved;
+    uint64_t busBytes;      // Running bus totals when the tick ended
+    uint64_t busErrors;
+    uint64_t counters[PERF_COUNTERS];   // perf counter deltas over the tick in PerfCounter order, 0 when unavailable
+};
+
+constexpr uint32_t TICK_SOLVED = 1u << 0;       // Joint targets were published
+constexpr uint32_t TICK_ESTOPPED = 1u << 1;
+
+// File layout: one header, then TickRecords back to back
+struct TickLogHeader {
+    uint32_t magic;         // "TICK"
+    uint16_t version;
+    uint16_t recordSize;    // sizeof(TickRecord), lets readers skip unknown trailing fields
+};
+
+constexpr uint32_t TICK_LOG_MAGIC = 0x4B434954;
+constexpr uint16_t TICK_LOG_VERSION = 2;
+
+// Per-tick flight recorder. record() is wait-free for the single control thread:
+// a copy into a preallocated slot and one release store. A background thread
+// drains the ring to a binary file. If it falls behind, new records are dropped
+// and counted instead of blocking the tick.
+class TickLog {
+public:
+    explicit TickLog(size_t capacity = 4096);   // Rounded up to a power of two
+    ~TickLog();
+
+    bool start(const std::string &path, std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+    void stop();    // Writes out what is left and closes the file
+
+    bool record(const TickRecord &record);
+
+    uint64_t recorded() const { return head_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+    static int64_t timestamp(std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+
+private:
+    void run(std::chrono::milliseconds interval);
+    bool drain();
+
+    std::vector<TickRecord> ring_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_;    // Next slot to fill, control thread only
+    alignas(64) std::atomic<uint64_t> tail_;    // Next slot to write out, drain thread only
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> written_;
+
+    int fd_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
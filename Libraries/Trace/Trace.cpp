@@ -0,0 +1,183 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t THREAD_EVENTS = 16384;     // Per thread and capture, later zones are dropped
+
+struct TraceEvent {
+    const char *name;
+    int64_t beginNs;
+    int64_t endNs;
+};
+
+// Written by its thread only, read by the exporter: same head/tail handoff as TickLog
+struct ThreadBuffer {
+    ThreadBuffer() : events(THREAD_EVENTS), head(0), tail(0), dropped(0), tid(static_cast<int>(syscall(SYS_gettid))) {}
+
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+    std::atomic<const char *> name{nullptr};
+    int tid;
+};
+
+// Buffers outlive their threads so a capture still covers threads that exited
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+
+ThreadBuffer &threadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+void writeName(FILE *file, const char *name) {
+    for (const char *c = name; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+        }
+        std::fputc(*c, file);
+    }
+}
+}
+
+std::atomic<bool> Trace::recording_{false};
+std::atomic<bool> TraceCapture::requested_{false};
+
+void Trace::start() {
+    // Drop whatever is left over from zones that finished after the last stop()
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto &buffer : registry) {
+        buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+    recording_.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop() {
+    recording_.store(false, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const char *name) {
+    threadBuffer().name.store(name, std::memory_order_relaxed);
+}
+
+void Trace::record(const char *name, int64_t beginNs, int64_t endNs) {
+    ThreadBuffer &buffer = threadBuffer();
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= THREAD_EVENTS) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer.events[head % THREAD_EVENTS] = {name, beginNs, endNs};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool Trace::exportJson(const std::string &path) {
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    const int pid = static_cast<int>(getpid());
+    bool first = true;
+    auto separator = [&] {
+        std::fputs(first ? "\n" : ",\n", file);
+        first = false;
+    };
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto &buffer : registry) {
+        if (const char *name = buffer->name.load(std::memory_order_relaxed)) {
+            separator();
+            std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"", pid,
+                         buffer->tid);
+            writeName(file, name);
+            std::fputs("\"}}", file);
+        }
+
+        // Complete events, microseconds with nanosecond decimals
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            const TraceEvent &event = buffer->events[tail % THREAD_EVENTS];
+            separator();
+            std::fputs("{\"name\":\"", file);
+            writeName(file, event.name);
+            std::fprintf(file, "\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", pid, buffer->tid,
+                         event.beginNs / 1000.0, (event.endNs - event.beginNs) / 1000.0);
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+
+        if (const uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed)) {
+            std::cerr << "Trace: thread " << buffer->tid << " dropped " << dropped << " zones" << std::endl;
+        }
+    }
+
+    std::fputs("\n]}\n", file);
+    return std::fclose(file) == 0;
+}
+
+TraceCapture::TraceCapture(std::string prefix, std::chrono::seconds duration)
+    : prefix_(std::move(prefix)), duration_(duration), running_(false), captures_(0) {}
+
+TraceCapture::~TraceCapture() {
+    stop();
+}
+
+bool TraceCapture::start() {
+    if (running_.exchange(true)) {
+        return false;
+    }
+
+    thread_ = std::thread(&TraceCapture::run, this);
+    return true;
+}
+
+void TraceCapture::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void TraceCapture::run() {
+    using clock = std::chrono::steady_clock;
+
+    while (running_.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!requested_.exchange(false, std::memory_order_relaxed)) {
+            continue;
+        }
+
+        // Ends early on shutdown, what was caught so far still gets written
+        Trace::start();
+        const auto end = clock::now() + duration_;
+        while (running_.load() && clock::now() < end) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        Trace::stop();
+
+        const std::string path = prefix_ + "-" + std::to_string(getpid()) + "-" + std::to_string(++captures_) + ".json";
+        if (Trace::exportJson(path)) {
+            std::cerr << "Trace: wrote " << path << std::endl;
+        } else {
+            std::cerr << "Trace: could not write " << path << std::endl;
+        }
+    }
+}
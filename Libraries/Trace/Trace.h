@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Scoped trace zones exported as Chrome / Perfetto trace-event JSON.
+//
+// TRACE_SCOPE("name") records how long the enclosing scope took on this thread.
+// Names must be string literals. Every thread writes to its own buffer, so a zone
+// costs two clock reads and a store into thread-local memory, and only while a
+// capture is running. Without ENABLE_TRACING (CMake option) the macros expand to
+// nothing and no zone is compiled in.
+#ifdef ENABLE_TRACING
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_THREAD(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#endif
+
+class Trace {
+public:
+    // Zones are only recorded between start() and stop()
+    static void start();
+    static void stop();
+    static bool recording() { return recording_.load(std::memory_order_relaxed); }
+
+    static void setThreadName(const char *name);
+    static void record(const char *name, int64_t beginNs, int64_t endNs);
+
+    // Everything recorded since the last export, as one trace-event JSON file
+    static bool exportJson(const std::string &path);
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static std::atomic<bool> recording_;
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : name_(name), begin_(Trace::recording() ? Trace::now() : -1) {}
+    ~TraceScope() {
+        if (begin_ >= 0) {
+            Trace::record(name_, begin_, Trace::now());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name_;
+    int64_t begin_;
+};
+
+// Background capture: request() (async-signal-safe, e.g. from SIGUSR1) records
+// every zone for `duration`, then writes <prefix>-<pid>-<n>.json
+class TraceCapture {
+public:
+    TraceCapture(std::string prefix, std::chrono::seconds duration);
+    ~TraceCapture();
+
+    bool start();
+    void stop();
+    static void request() { requested_.store(true, std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    std::string prefix_;
+    std::chrono::seconds duration_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    int captures_;
+
+    static std::atomic<bool> requested_;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer / single-consumer triple buffer. The writer fills
+// back() and publish()es it; the reader always gets the latest complete value,
+// older unread ones are simply overwritten. Neither side ever waits.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : buffers_{}, state_(MIDDLE), back_(0), front_(2) {}
+
+    explicit TripleBuffer(const T &initial) : TripleBuffer() {
+        buffers_[0] = buffers_[1] = buffers_[2] = initial;
+    }
+
+    // Writer side
+    T &back() { return buffers_[back_]; }
+    void publish() {
+        back_ = state_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+    void publish(const T &value) {
+        back() = value;
+        publish();
+    }
+
+    // Reader side: update() swaps in the newest value if there is one
+    bool update() {
+        if (!(state_.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front_ = state_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T &front() const { return buffers_[front_]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x03;
+    static constexpr uint8_t FRESH = 0x04;      // Middle buffer holds an unread value
+    static constexpr uint8_t MIDDLE = 1;
+
+    T buffers_[3];
+    alignas(64) std::atomic<uint8_t> state_;    // Middle buffer index + FRESH
+    alignas(64) uint8_t back_;                  // Writer only
+    alignas(64) uint8_t front_;                 // Reader only
+};
@@ -0,0 +1,79 @@
+// Percentiles from the log-linear buckets against the exact order statistics of a
+// known distribution: never below the true value, at most ~3% above it.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../Libraries/Histogram/Histogram.h"
+
+namespace {
+// Resolution the dashboard's p99 needs, one step of a 1/32 split octave
+constexpr uint64_t ERROR_DIVISOR = 32;
+
+int failures = 0;
+
+void check(bool ok, const char *what, double p, uint64_t exact, uint64_t reported) {
+    if (!ok) {
+        std::printf("FAIL: %s p%g exact %llu us, reported %llu us\n", what, p, static_cast<unsigned long long>(exact),
+                    static_cast<unsigned long long>(reported));
+        failures++;
+    }
+}
+
+// Same rank as the histogram: 1-based, p of the way from the smallest to the largest
+uint64_t exactPercentile(const std::vector<uint64_t> &sorted, double p) {
+    const size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1));
+    return sorted[rank];
+}
+
+void checkDistribution(const char *name, std::vector<uint64_t> values) {
+    LatencyHistogram histogram;
+    for (uint64_t us : values) {
+        histogram.record(std::chrono::microseconds(us));
+    }
+    const LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+    std::sort(values.begin(), values.end());
+
+    for (double p : {1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+        const uint64_t exact = exactPercentile(values, p);
+        const uint64_t bound = exact + exact / ERROR_DIVISOR;
+        const uint64_t live = static_cast<uint64_t>(histogram.percentile(p).count());
+        const uint64_t snap = static_cast<uint64_t>(snapshot.percentile(p).count());
+        check(live >= exact && live <= bound, name, p, exact, live);
+        check(snap >= exact && snap <= bound, name, p, exact, snap);
+    }
+}
+} // namespace
+
+int main() {
+    // Every value from 1 us to 20 ms once: exact below the first octave, linear steps above
+    std::vector<uint64_t> uniform;
+    for (uint64_t us = 1; us <= 20000; us++) {
+        uniform.push_back(us);
+    }
+    checkDistribution("uniform", uniform);
+
+    // Log-uniform from 1 us to 1 s, the spread a bus or scheduler latency actually has
+    std::vector<uint64_t> logUniform;
+    uint64_t state = 12345;
+    for (int i = 0; i < 100000; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        const double unit = static_cast<double>(state >> 11) / static_cast<double>(1ull << 53);
+        logUniform.push_back(static_cast<uint64_t>(std::pow(10.0, unit * 6.0)));
+    }
+    checkDistribution("log-uniform", logUniform);
+
+    // Every bucket bound is the last value that maps to it
+    for (size_t i = 0; i + 1 < LatencyHistogram::BUCKETS; i++) {
+        const uint64_t upper = LatencyHistogram::bucketUpperUs(i);
+        if (LatencyHistogram::bucketIndex(upper) != i || LatencyHistogram::bucketIndex(upper + 1) != i + 1) {
+            std::printf("FAIL: bucket %zu bound %llu\n", i, static_cast<unsigned long long>(upper));
+            failures++;
+        }
+    }
+
+    std::printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+// An emergency stop that lands while a channel burst is on the bus must still
+// leave every output off, whichever of the two reaches the chip last.
+
+#include <cstdio>
+
+#include "../Libraries/PCA9685/PCA9685.h"
+#include "../Libraries/PCA9685/PCA9685Emulator.h"
+
+namespace {
+constexpr uint8_t ADDRESS = 0x40;
+constexpr uint16_t FULL_OFF = 0x1000;
+
+// Raises the e-stop from "another thread" just before a channel burst reaches the chip,
+// so the broadcast goes out first and the burst lands after it
+class EstopDuringBurst : public I2CBackend {
+public:
+    explicit EstopDuringBurst(PCA9685Emulator &bus) : bus_(bus), pwm_(nullptr), armed_(false) {}
+
+    void arm(PCA9685 &pwm) {
+        pwm_ = &pwm;
+        armed_ = true;
+    }
+
+    bool transfer(i2c_msg *msgs, size_t count) override {
+        if (armed_ && count == 1 && msgs[0].len > 5) {
+            armed_ = false;
+            pwm_->emergencyStop();
+        }
+        return bus_.transfer(msgs, count);
+    }
+
+private:
+    PCA9685Emulator &bus_;
+    PCA9685 *pwm_;
+    bool armed_;
+};
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+bool allFullOff(const PCA9685Emulator &bus, uint8_t lo, uint8_t hi) {
+    for (uint8_t ch = lo; ch <= hi; ch++) {
+        if (!(bus.offTicks(ADDRESS, ch) & FULL_OFF)) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+int main() {
+    PCA9685Emulator emulator;
+    emulator.addDevice(ADDRESS);
+    EstopDuringBurst bus(emulator);
+
+    PCA9685 pwm(ADDRESS, "emulator");
+    pwm.setBackend(&bus);
+    check(pwm.open(), "open");
+
+    // Staged group: one burst over channels 0..5
+    bus.arm(pwm);
+    pwm.beginUpdate();
+    for (uint8_t ch = 0; ch < 6; ch++) {
+        pwm.setPWM(ch, 0, 300 + ch);
+    }
+    check(!pwm.commitUpdate(), "burst reports the e-stop");
+    check(pwm.emergencyStopped(), "e-stop latched");
+    check(allFullOff(emulator, 0, 5), "staged burst: outputs off after the e-stop");
+
+    // Whole-arm path used by the output scheduler
+    pwm.clearEmergencyStop();
+    const float targets[16] = {90, 90, 90, 90, 90, 90};
+    const float smoothness[16] = {};
+    for (uint8_t ch = 0; ch < 6; ch++) {
+        pwm.setServoType(ch, 1);
+        pwm.profiler().reset(ch, 90);
+    }
+    bus.arm(pwm);
+    check(!pwm.updateJoints(targets, smoothness, 0x3F), "updateJoints reports the e-stop");
+    check(allFullOff(emulator, 0, 5), "updateJoints burst: outputs off after the e-stop");
+
+    std::printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// Follows the control loop's shared-memory telemetry and prints it as CSV.
+//
+//   Telemetry_Tail [--name /6dof_telemetry] [--from-start] [--count N] [--poll-ms 10]
+//
+// Starts at the newest record unless --from-start, which replays what is still
+// in the ring. Records overwritten before they could be read are reported on
+// stderr; the control loop is never slowed down by a slow reader.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../Libraries/Shm_Telemetry/Shm_Telemetry.h"
+
+namespace {
+struct Options {
+    std::string name = SHM_TELEMETRY_NAME;
+    bool fromStart = false;
+    uint64_t count = 0;         // 0 = follow until interrupted
+    int pollMs = 10;
+};
+
+void usage(const char *argv0) {
+    std::fprintf(stderr, "Usage: %s [--name SHM_NAME] [--from-start] [--count N] [--poll-ms MS]\n", argv0);
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+
+        if (!std::strcmp(arg, "--name") && hasValue) {
+            opt.name = argv[++i];
+        } else if (!std::strcmp(arg, "--from-start")) {
+            opt.fromStart = true;
+        } else if (!std::strcmp(arg, "--count") && hasValue) {
+            opt.count = std::strtoull(argv[++i], nullptr, 0);
+        } else if (!std::strcmp(arg, "--poll-ms") && hasValue) {
+            opt.pollMs = std::atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return opt.pollMs > 0;
+}
+
+// One column per PerfCounter, in enum order
+static_assert(PERF_COUNTERS == 5, "Counter columns in printHeader() are out of date");
+
+void printHeader() {
+    std::printf("tick,sampled_ns,wake_ns,solved_ns,published_ns,x,y,z,roll,pitch,yaw,"
+                "joint0,joint1,joint2,joint3,joint4,joint5,ik_status,ik_iterations,flags,bus_bytes,bus_errors,"
+                "cycles,instructions,cache_misses,branch_misses,context_switches\n");
+}
+
+void printRecord(const TickRecord &r) {
+    std::printf("%llu,%lld,%lld,%lld,%lld", static_cast<unsigned long long>(r.tick), static_cast<long long>(r.sampledNs),
+                static_cast<long long>(r.wakeNs), static_cast<long long>(r.solvedNs),
+                static_cast<long long>(r.publishedNs));
+    for (float value : r.pose) {
+        std::printf(",%.6f", value);
+    }
+    for (float value : r.joints) {
+        std::printf(",%.4f", value);
+    }
+    std::printf(",%d,%d,%u,%llu,%llu", r.ikStatus, r.ikIterations, r.flags,
+                static_cast<unsigned long long>(r.busBytes), static_cast<unsigned long long>(r.busErrors));
+    for (uint64_t value : r.counters) {
+        std::printf(",%llu", static_cast<unsigned long long>(value));
+    }
+    std::printf("\n");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ShmTelemetryReader reader(opt.name);
+    if (!reader.open()) {
+        std::fprintf(stderr, "No telemetry at /dev/shm%s (control loop not running, or a different layout version)\n",
+                     opt.name.c_str());
+        return 1;
+    }
+    if (opt.fromStart) {
+        reader.seekOldest();
+    }
+
+    printHeader();
+    TickRecord record;
+    uint64_t printed = 0;
+    uint64_t reportedLost = 0;
+    while (opt.count == 0 || printed < opt.count) {
+        if (!reader.next(record)) {
+            std::fflush(stdout);
+            std::this_thread::sleep_for(std::chrono::milliseconds(opt.pollMs));
+            continue;
+        }
+        printRecord(record);
+        printed++;
+
+        if (reader.lost() != reportedLost) {
+            std::fprintf(stderr, "Lost %llu records, reader too slow\n",
+                         static_cast<unsigned long long>(reader.lost() - reportedLost));
+            reportedLost = reader.lost();
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <cstdlib>  // strtol()
+#include <cerrno>
 #include <unistd.h>   // getpid(), sleep()
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
@@ -8,6 +10,8 @@
 #include <chrono>   // Time
 #include <stdio.h>
 #include <signal.h>
+#include <sys/mman.h>   // mlockall()
+#include <malloc.h>     // mallopt()
 #include <vector>
 #include <iomanip>
 #include <thread> // Enable multi-processing (threads)
@@ -15,10 +19,21 @@
 #include <ftxui/screen/screen.hpp>                  // For static rendering and printing
 #include <ftxui/component/component.hpp>            // For interactive buttons, menus, and inputs
 #include <ftxui/component/screen_interactive.hpp>   // For interactive main loops
-#include <ftxui/dom/table.hpp>                      // For the Table class
 
 
 #include "Libraries/PCA9685/PCA9685.h"
+#include "Libraries/PCA9685/I2CUring.h"
+#include "Libraries/Output_Scheduler/Output_Scheduler.h"
+#include "Libraries/Joint_State/Joint_State.h"
+#include "Libraries/Periodic_Loop/Periodic_Loop.h"
+#include "Libraries/Triple_Buffer/Triple_Buffer.h"
+#include "Libraries/Seqlock/Seqlock.h"
+#include "Libraries/Tick_Log/Tick_Log.h"
+#include "Libraries/Shm_Telemetry/Shm_Telemetry.h"
+#include "Libraries/Trace/Trace.h"
+#include "Libraries/Perf_Counters/Perf_Counters.h"
+#include "Libraries/Control_Link/Control_Link.h"
+#include "Libraries/Dashboard/Dashboard.h"
 #include "Libraries/Controller/Controller.h"
 #include "Libraries/Utilities/Utilities.h"
 #include "Libraries/Inverse_Kinematics/Inverse_Kinematics.h"
@@ -37,6 +52,26 @@
 #define FINGER      5
 
 // Other
+#define PWM_FREQ_HZ 50   // Servo frame rate, up to ~300 Hz for digital servos
+#define JOINT_STATE_FILE "/var/tmp/6dof_joints.state"
+#define TICK_LOG_FILE "/var/tmp/6dof_ticks.bin"     // Per-tick record of the IK loop, "" to disable
+#define TRACE_FILE_PREFIX "/var/tmp/6dof_trace"     // With ENABLE_TRACING: SIGUSR1 captures a Chrome trace
+#define TRACE_CAPTURE_S 5
+#define INPUT_RATE_HZ   100   // Controller sampling and e-stop polling
+#define IK_RATE_HZ      50    // IK solves, servo output runs at the PWM frame rate
+#define IK_RT_PRIORITY  0     // SCHED_FIFO priority for the IK loop, 0 = normal scheduling (--rt overrides)
+#define IK_CPU          -1    // Pin the IK loop to this CPU, -1 = any
+#define IK_PERF_COUNTERS 1    // Count cycles, cache misses etc. on the IK thread (perf_event_open)
+#define UI_RATE_HZ      12    // Dashboard redraws and ControlLink status snapshots, independent of the control rates
+#define UI_STALE_MS     1000  // --ui: warn once the control process hasn't published for this long
+#define STATS_INTERVAL_S 5    // Headless: seconds between stats lines
+#define SHUTDOWN_TIMEOUT_S 5  // Cut the outputs and exit if shutdown takes longer than this
+
+// Full-deflection joystick speeds, per second so they don't depend on IK_RATE_HZ
+#define XY_SPEED    (20.0 / 750)    // m/s
+#define Z_SPEED     (20.0 / 1000)   // m/s per unit of trigger curve
+#define ANGLE_SPEED (20.0 / 15)     // rad/s
+
 #define DEADZONE    5000
 #define VECTOR_MAX  37000 // Controller joysticks are NOT circular: Should be 32767, but it CAN go up to ~36500. WHY??
 
@@ -104,20 +139,170 @@ void signal_handler(int sig) {
     g_running = 0;
 }
 
+// Ctrl+\ cuts all outputs right away, no homing
+void estop_handler(int sig) {
+    (void)sig;
+    if (g_pwm) {
+        g_pwm->emergencyStop();
+    }
+    g_running = 0;
+}
 
+// SIGUSR1: record trace zones for TRACE_CAPTURE_S, then write them out
+void trace_handler(int sig) {
+    (void)sig;
+    TraceCapture::request();
+}
 
-int main() {
-    
+// Shutdown ran past SHUTDOWN_TIMEOUT_S (bus or thread hung): outputs off and leave
+void shutdown_watchdog(int sig) {
+    (void)sig;
+    if (g_pwm) {
+        g_pwm->allOff();
+    }
+    _exit(1);
+}
+
+// --ui: dashboard as its own process, attached to a running control process over the
+// ControlLink. Terminal resizes, slow SSH sessions and rendering stay out of the control
+// process; operator commands go back through the link's command queue
+int run_ui() {
+    using namespace ftxui;
+    auto screen = ScreenInteractive::TerminalOutput();
+
+    // Only touched from the screen loop thread
+    ControlLink link;
+    Dashboard dashboard;
+    ControlStatus status{};
+    std::string notice;
+
+    const auto send = [&](ControlCommandType type, const char *what) {
+        notice = link.send(type) ? std::string(what) + " sent" : std::string(what) + " not sent: no control process";
+    };
+
+    auto renderer = Renderer([&] {
+        // Control process restarted or not up yet: keep trying to attach
+        bool live = link.load(status);
+        if (!live) {
+            link.close();
+            live = link.attach() && link.load(status);
+        }
+        if (!live) {
+            return vbox({text("Waiting for the control process (" + std::string(CONTROL_LINK_NAME) + ")...") | bold,
+                         text("q quit") | dim});
+        }
+
+        dashboard.refresh(status);
+        const int64_t age_ms = (ControlLink::clockNs() - status.publishedNs) / 1000000;
+        Element state = text("Control PID " + std::to_string(status.controlPid));
+        if (status.flags & STATUS_ESTOPPED) {
+            state = text("Control PID " + std::to_string(status.controlPid) + ": EMERGENCY STOPPED") | bold | color(Color::Red);
+        } else if (age_ms > UI_STALE_MS) {
+            state = text("Control PID " + std::to_string(status.controlPid) + " not responding for " +
+                         std::to_string(age_ms) + " ms") | bold | color(Color::Yellow);
+        }
+        return vbox({
+            dashboard.render(),
+            hbox({state, text("  " + notice)}),
+            text("e emergency stop | t trace capture | s stop control | q quit UI") | dim
+        });
+    });
+
+    auto component = CatchEvent(renderer, [&](Event event) {
+        if (event == Event::Character('e')) {
+            send(ControlCommandType::EmergencyStop, "Emergency stop");
+        } else if (event == Event::Character('t')) {
+            send(ControlCommandType::TraceCapture, "Trace capture");
+        } else if (event == Event::Character('s')) {
+            send(ControlCommandType::Shutdown, "Shutdown");
+        } else if (event == Event::Character('q')) {
+            screen.ExitLoopClosure()();
+        } else {
+            return false;
+        }
+        return true;
+    });
+
+    // Redraws at UI_RATE_HZ whether or not anything changed, that is what shows a stale link
+    std::atomic<bool> ui_running{true};
+    std::thread ui_thread([&]() {
+        PeriodicLoop ui_loop(UI_RATE_HZ);
+        while (ui_running.load()) {
+            ui_loop.next();
+            screen.PostEvent(Event::Custom);
+        }
+    });
+
+    screen.Loop(component);
+    ui_running = false;
+    ui_thread.join();
+    return 0;
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+    // Headless: same control pipeline without the terminal UI, for running as a service.
+    // Also used when stdout is not a terminal. The dashboard can then run separately with --ui
+    bool headless = !isatty(STDOUT_FILENO);
+    bool ui_only = false;
+    bool hold = false;      // Leave the arm powered on a normal exit, the next start takes over where it stopped
+    int rt_priority = IK_RT_PRIORITY;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--hold") {
+            hold = true;
+        } else if (arg == "--ui") {
+            ui_only = true;
+        } else if (arg == "--rt" && i + 1 < argc) {
+            char *end = nullptr;
+            const long value = std::strtol(argv[++i], &end, 10);
+            const bool number = end != argv[i] && *end == '\0';
+            rt_priority = number && value >= 0 && value <= 98 ? static_cast<int>(value) : -1;   // Rejected below
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--headless] [--hold] [--rt PRIORITY] | --ui" << std::endl;
+            return 1;
+        }
+    }
+    // Output runs one above the given priority, so 98 is the highest SCHED_FIFO leaves for it
+    if (rt_priority < 0 || rt_priority > 98) {
+        std::cerr << "--rt takes a SCHED_FIFO priority from 1 to 98, or 0 for normal scheduling" << std::endl;
+        return 1;
+    }
+
+    // No hardware in this process, only the dashboard
+    if (ui_only) {
+        return run_ui();
+    }
 
     std::cout << "Process started\n";
     std::cout << "PID: " << getpid() << std::endl;
 
-    //
-    // TUI
-    //
-    using namespace ftxui;
-    auto screen = ScreenInteractive::TerminalOutput();
+    // Claimed before touching any hardware: the region's owner is the one process driving the arm
+    ControlLink link;
+    if (!link.create()) {
+        if (errno == EBUSY) {
+            std::cerr << "Another control process owns /dev/shm" << CONTROL_LINK_NAME
+                      << ", not driving the same PCA9685 twice" << std::endl;
+            return 1;
+        }
+        std::cerr << "Could not create /dev/shm" << CONTROL_LINK_NAME << ", no --ui access" << std::endl;
+    }
 
+    // Real-time control: everything mapped now and later stays resident, and freed heap is
+    // kept instead of handed back, so the loops never take a page fault after start-up
+    if (rt_priority > 0) {
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            std::cerr << "mlockall failed (see RLIMIT_MEMLOCK), memory may be paged out" << std::endl;
+        }
+    }
+
+    using namespace ftxui;
 
     //
     // I2C
@@ -133,19 +318,69 @@ int main() {
         return 1;
     }
 
+    // Servo writes go through io_uring when the kernel allows it, must outlive pwm
+    I2CUring ring;
+
     // Create PCA9685 instance and initialize it
-    PCA9685 pwm(address, i2c_device);
+    PCA9685 pwm(address, i2c_device, PWM_FREQ_HZ);
     g_pwm = &pwm;  // Set global pointer for cleanup after loop
 
     // Register Ctrl+C / termination handlers.
     ::signal(SIGINT, signal_handler);
     ::signal(SIGTERM, signal_handler);
+    ::signal(SIGQUIT, estop_handler);
+#ifdef ENABLE_TRACING
+    ::signal(SIGUSR1, trace_handler);
+    TraceCapture trace_capture(TRACE_FILE_PREFIX, std::chrono::seconds(TRACE_CAPTURE_S));
+    trace_capture.start();
+#endif
+
+    // Servo on every joint, and where homing leaves it
+    const ServoTarget home[] = {
+        {BASE,      MS62_SERVO,   135},
+        {SHOULDER,  MS62_SERVO_A, 141},
+        {UPPER_ARM, DM996_SERVO,  60},
+        {FOREARM,   DM996_SERVO,  90},
+        {WIRST,     DM996_SERVO,  90},
+        {FINGER,    DM996_SERVO,  90},
+    };
+    for (const ServoTarget &joint : home) {
+        pwm.setServoType(joint.channel, joint.servoType);
+    }
 
-    if (!pwm.open()) {
+    // Warm: keep whatever the chip is still driving instead of dropping the arm
+    if (!pwm.open(PCA9685::StartMode::Warm)) {
         std::cerr << "Failed to open PCA9685 on " << i2c_device << std::endl;
         return 1;
     }
-    std::cout << "PCA9685 initialized at 50Hz." << std::endl;
+    std::cout << "PCA9685 initialized at " << pwm.getPWMFreq() << "Hz." << std::endl;
+
+    if (ring.init()) {
+        pwm.setTransport(&ring);
+    } else {
+        std::cout << "io_uring unavailable, using blocking I2C writes." << std::endl;
+    }
+
+    // Last commanded angles of the previous run, refined against the adopted outputs
+    JointStateFile jointState(JOINT_STATE_FILE);
+    if (jointState.open()) {
+        float saved[16];
+        uint16_t savedMask = 0;
+        if (jointState.load(saved, savedMask)) {
+            pwm.resumeFrom(saved, savedMask);
+        }
+    } else {
+        std::cerr << "Joint state file " << JOINT_STATE_FILE << " unavailable, starting without it" << std::endl;
+    }
+
+    // Don't put sub-tick dithering from smoothing and stick noise on the bus
+    for (uint8_t ch = BASE; ch <= FINGER; ch++) {
+        pwm.setHysteresis(ch, 0.5f);
+    }
+
+    // Frame-aligned servo output
+    OutputScheduler output(pwm);
+    output.setStateFile(&jointState);
 
 
     //
@@ -166,43 +401,100 @@ int main() {
     
     SDL_Event e;
 
+    output.start();
+    // Servo frames have the hardest deadline, one above the IK loop
+    if (rt_priority > 0 && !output.setRealtime(rt_priority + 1)) {
+        std::cerr << "SCHED_FIFO unavailable for the output scheduler, running with normal priority" << std::endl;
+    }
     std::cout << "Ready!" << std::endl;
     
     //
     // PROGRAM START
     //
 
-    // Atomic values for what has to be displayed
-    std::atomic<float> x{0.0f}, y{0.0f}, z{0.3f}, x_delta{0.0f}, y_delta{0.0f}, z_delta {0.0f}, roll{0.0f}, pitch{0.0f}, yaw{0.0f}, roll_delta{0.0f}, pitch_delta{0.0f}, yaw_delta{0.0f}, angle0{0.0f}, angle1{0.0f}, angle2{0.0f}, angle3{0.0f}, angle4{0.0f}, angle5{0.0f};
+    // Emergency stop latency: button press -> outputs off
+    std::atomic<uint32_t> estop_latency_ms{0};
+    std::atomic<int64_t> estop_write_us{-1};
+
+    // Everything the dashboard shows, published once per IK tick as one consistent snapshot
+    Seqlock<Telemetry> telemetry{Telemetry{}};
     //std::atomic<std::string> text;
 
-    // Start IK Thread
-    std::thread ik_thread([&]() {
-        
+    // Pipeline: input -> IK -> output scheduler, one thread and rate per stage. Each
+    // handoff is a triple buffer, so a slow IK solve never holds up input or a servo frame
+    struct PoseSample {
+        float x, y, z, roll, pitch, yaw;
+        float x_delta, y_delta, z_delta, roll_delta, pitch_delta, yaw_delta;
+        std::chrono::steady_clock::time_point sampled;
+    };
+    TripleBuffer<PoseSample> pose_buffer;
+    LatencyHistogram pose_age;      // Input sample -> IK picks it up
+    LatencyHistogram ik_solve;      // IK_solver call alone
+
+    // Hardware counters on the IK thread, split into the solve and everything after it
+    PerfStage ik_tick_perf;
+    PerfStage ik_solve_perf;
+    PerfStage ik_post_perf;
+
+    // Flight recorder for the IK loop, written to disk in the background
+    TickLog tick_log;
+    if (TICK_LOG_FILE[0] != '\0' && !tick_log.start(TICK_LOG_FILE)) {
+        std::cerr << "Could not open tick log " << TICK_LOG_FILE << ", not recording ticks" << std::endl;
+    }
+
+    // Same records live in /dev/shm for other processes (Telemetry_Tail, plotting tools)
+    ShmTelemetryWriter shm_telemetry;
+    if (!shm_telemetry.open()) {
+        std::cerr << "Could not create /dev/shm" << SHM_TELEMETRY_NAME << ", no shared-memory telemetry" << std::endl;
+    }
+
+    // Input stage: controller, e-stop and pose integration
+    PeriodicLoop input_loop(INPUT_RATE_HZ);
+    std::thread input_thread([&]() {
+
         float angleLS = 0;
         float angleRS = 0;
-        float RS = 90;
 
-        while (g_running) {
-            // Stop program if 'minus' is pressed.
-            if (!c8bitdo.getProgramState()) {
-                g_running = false;
+        // Pose is owned by this thread, the others only see published samples
+        float x = 0.0f, y = 0.0f, z = 0.3f, roll = 0.0f, pitch = 0.0f, yaw = 0.0f;
+        float x_delta = 0.0f, y_delta = 0.0f, z_delta = 0.0f, roll_delta = 0.0f, pitch_delta = 0.0f, yaw_delta = 0.0f;
 
-                screen.ExitLoopClosure()();
-                break;
-            }
+        // Same priority as IK: the e-stop button is polled here
+        if (rt_priority > 0 && !input_loop.setRealtime(rt_priority)) {
+            std::cerr << "SCHED_FIFO unavailable for the input loop, running with normal priority" << std::endl;
+        }
+
+        TRACE_THREAD("input");
+        while (g_running) {
+            // Absolute deadlines: the period no longer stretches by the work done in it
+            const float dt = input_loop.next();
+            TRACE_SCOPE("input tick");
 
             // Update joystick axes
             c8bitdo.updateAxes();
 
             // Check for button events
-            while (SDL_PollEvent(&e)) {
-                if (e.type == SDL_JOYBUTTONDOWN || e.type == SDL_CONTROLLERBUTTONDOWN) {
-                    c8bitdo.handleJoyButtons(e);
-                }
-
-                if (e.type == SDL_QUIT || e.type == SDL_JOYDEVICEREMOVED) {
-                    g_running = 0;
+            {
+                TRACE_SCOPE("SDL_PollEvent");
+                while (SDL_PollEvent(&e)) {
+                    if (e.type == SDL_JOYBUTTONDOWN || e.type == SDL_CONTROLLERBUTTONDOWN) {
+                        c8bitdo.handleJoyButtons(e);
+
+                        // Emergency stop if 'minus' is pressed: cut outputs before anything else
+                        if (!c8bitdo.getProgramState()) {
+                            auto t0 = std::chrono::steady_clock::now();
+                            pwm.emergencyStop();
+                            auto t1 = std::chrono::steady_clock::now();
+                            estop_write_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+                            estop_latency_ms = SDL_GetTicks() - c8bitdo.getStopTimestamp();
+                            g_running = 0;
+                            break;
+                        }
+                    }
+
+                    if (e.type == SDL_QUIT || e.type == SDL_JOYDEVICEREMOVED) {
+                        g_running = 0;
+                    }
                 }
             }
 
@@ -220,8 +512,8 @@ int main() {
                 float vectorLS = c8bitdo.getLSVector() / VECTOR_MAX;
                 angleLS = c8bitdo.getLSAngle();
 
-                x_delta = (cos(angleLS) * vectorLS)/750;
-                y_delta = (sin(angleLS) * vectorLS)/750;
+                x_delta = cos(angleLS) * vectorLS * XY_SPEED * dt;
+                y_delta = sin(angleLS) * vectorLS * XY_SPEED * dt;
 
                 x += x_delta;
                 y += y_delta;
@@ -231,9 +523,8 @@ int main() {
             }
 
             // Z movement
-            z -= c8bitdo.getLTCurve()/1000;
-            z += c8bitdo.getRTCurve()/1000;
-            z_delta = -(c8bitdo.getLTCurve()/1000) + c8bitdo.getRTCurve()/1000;
+            z_delta = (c8bitdo.getRTCurve() - c8bitdo.getLTCurve()) * Z_SPEED * dt;
+            z += z_delta;
             z = constrain(z, -0.3, 0.3);
 
             // beta, gamma movement
@@ -244,8 +535,8 @@ int main() {
                 angleRS = c8bitdo.getRSAngle();
 
 
-                pitch_delta = (cos(angleRS) * vectorRS) / 15;
-                yaw_delta   = (sin(angleRS) * vectorRS) / 15;
+                pitch_delta = cos(angleRS) * vectorRS * ANGLE_SPEED * dt;
+                yaw_delta   = sin(angleRS) * vectorRS * ANGLE_SPEED * dt;
 
                 pitch += pitch_delta;
                 yaw   += yaw_delta;
@@ -257,6 +548,46 @@ int main() {
             // alpha movement (REDUNDANT)
             roll = c8bitdo.getBMPValue();
 
+            pose_buffer.publish({x, y, z, roll, pitch, yaw, x_delta, y_delta, z_delta, roll_delta, pitch_delta, yaw_delta,
+                                 std::chrono::steady_clock::now()});
+        } // End of loop
+    });
+
+    // IK stage: solves the newest pose and posts joint targets
+    PeriodicLoop ik_loop(IK_RATE_HZ);
+    std::thread ik_thread([&]() {
+
+        float RS = 90;
+        Telemetry snapshot = telemetry.load();
+
+        if (rt_priority > 0 && !ik_loop.setRealtime(rt_priority)) {
+            std::cerr << "SCHED_FIFO unavailable for the IK loop, running with normal priority" << std::endl;
+        }
+        if (IK_CPU >= 0 && !ik_loop.setAffinity(IK_CPU)) {
+            std::cerr << "Could not pin the IK loop to CPU " << IK_CPU << std::endl;
+        }
+
+        TRACE_THREAD("ik");
+        TickRecord tick{};
+
+        // Counters follow the thread that opens them
+        PerfCounters perf;
+        if (IK_PERF_COUNTERS && !perf.open()) {
+            std::cerr << "perf_event_open denied (see perf_event_paranoid), IK loop runs without counters" << std::endl;
+        }
+        PerfSample perf_wake{}, perf_solved{}, perf_done{};
+        while (g_running) {
+            ik_loop.next();
+            TRACE_SCOPE("ik tick");
+            const auto wake = std::chrono::steady_clock::now();
+
+            // Nothing sampled since the last solve
+            if (!pose_buffer.update()) {
+                continue;
+            }
+            perf.read(perf_wake);
+            const PoseSample &pose = pose_buffer.front();
+            pose_age.record(wake - pose.sampled);
 
             // x,y,z debug
             //std::cout << "x: " << std::setw(5) << x << std::setw(5) << "y: " << std::setw(5) << y << std::setw(5) << "z: " << std::setw(5) << z << std::endl;
@@ -266,7 +597,12 @@ int main() {
 
             // IK solver
             bool solution_found = false;
-            std::vector<double> IK_Solutions = IK_solver(x, y, z, roll, pitch, yaw);
+            IKInfo ik_info{};
+            const auto solve_start = std::chrono::steady_clock::now();
+            std::vector<double> IK_Solutions = IK_solver(pose.x, pose.y, pose.z, pose.roll, pose.pitch, pose.yaw, &ik_info);
+            const auto solved = std::chrono::steady_clock::now();
+            ik_solve.record(solved - solve_start);
+            perf.read(perf_solved);
             if(IK_Solutions[0] == -1) {
                 //text.store("No solution found: IK error.");
                 solution_found = false;
@@ -286,26 +622,68 @@ int main() {
 
 
             // Input solutions to servo motors
-            double smoothness = 0.3;
+            float smoothness = 0.1;     // Degrees, angles are no longer truncated so this can stay small
             if(true and solution_found){
-                pwm.setSmoothServoAngle(BASE, MS62_SERVO, IK_Solutions[0] + 135, smoothness);
-                angle0.store(IK_Solutions[0] + 135);
-                usleep(20);
-                pwm.setSmoothServoAngle(SHOULDER, MS62_SERVO_A, IK_Solutions[1] + 45, smoothness);
-                angle1.store(IK_Solutions[1] + 45);
-                usleep(20);
-                pwm.setSmoothServoAngle(UPPER_ARM, DM996_SERVO, IK_Solutions[2] + 90, smoothness);
-                angle2.store(IK_Solutions[2] + 90);
-                usleep(20);
-                pwm.setSmoothServoAngle(FOREARM, DM996_SERVO, IK_Solutions[3] + 90, smoothness);
-                angle3.store(IK_Solutions[3] + 90);
-                usleep(20);
-                pwm.setSmoothServoAngle(WIRST, DM996_SERVO, IK_Solutions[4] + 90, smoothness);
-                angle4.store(IK_Solutions[4] + 90);
-                usleep(20);
+                // Targets only, the output scheduler writes them once per PWM frame
+                output.setJoint(BASE, MS62_SERVO, IK_Solutions[0] + 135, smoothness);
+                snapshot.angle[0] = IK_Solutions[0] + 135;
+                output.setJoint(SHOULDER, MS62_SERVO_A, IK_Solutions[1] + 45, smoothness);
+                snapshot.angle[1] = IK_Solutions[1] + 45;
+                output.setJoint(UPPER_ARM, DM996_SERVO, IK_Solutions[2] + 90, smoothness);
+                snapshot.angle[2] = IK_Solutions[2] + 90;
+                output.setJoint(FOREARM, DM996_SERVO, IK_Solutions[3] + 90, smoothness);
+                snapshot.angle[3] = IK_Solutions[3] + 90;
+                output.setJoint(WIRST, DM996_SERVO, IK_Solutions[4] + 90, smoothness);
+                snapshot.angle[4] = IK_Solutions[4] + 90;
                 
-                //pwm.setSmoothServoAngle(FINGER, DM996_SERVO, rt, 2);
+                //output.setJoint(FINGER, DM996_SERVO, rt, 2);
+                output.publish(pose.sampled);
+            }
+
+            // Pose and the angles solved from it go out together
+            snapshot.x = pose.x;
+            snapshot.y = pose.y;
+            snapshot.z = pose.z;
+            snapshot.roll = pose.roll;
+            snapshot.pitch = pose.pitch;
+            snapshot.yaw = pose.yaw;
+            snapshot.x_delta = pose.x_delta;
+            snapshot.y_delta = pose.y_delta;
+            snapshot.z_delta = pose.z_delta;
+            snapshot.roll_delta = pose.roll_delta;
+            snapshot.pitch_delta = pose.pitch_delta;
+            snapshot.yaw_delta = pose.yaw_delta;
+            telemetry.store(snapshot);
+
+            const BusStats bus = pwm.getBusStats();
+            tick.tick = ik_loop.ticks();
+            tick.sampledNs = TickLog::timestamp(pose.sampled);
+            tick.wakeNs = TickLog::timestamp(wake);
+            tick.solvedNs = TickLog::timestamp(solved);
+            tick.publishedNs = TickLog::timestamp(std::chrono::steady_clock::now());
+            tick.pose[0] = pose.x;
+            tick.pose[1] = pose.y;
+            tick.pose[2] = pose.z;
+            tick.pose[3] = pose.roll;
+            tick.pose[4] = pose.pitch;
+            tick.pose[5] = pose.yaw;
+            std::copy(std::begin(snapshot.angle), std::end(snapshot.angle), tick.joints);
+            tick.ikStatus = ik_info.status;
+            tick.ikIterations = ik_info.iterations;
+            tick.flags = (solution_found ? TICK_SOLVED : 0) | (pwm.emergencyStopped() ? TICK_ESTOPPED : 0);
+            tick.busBytes = bus.bytes;
+            tick.busErrors = bus.errors;
+
+            if (perf.available() && perf.read(perf_done)) {
+                ik_tick_perf.add(perf_wake, perf_done);
+                ik_solve_perf.add(perf_wake, perf_solved);
+                ik_post_perf.add(perf_solved, perf_done);
+                for (size_t i = 0; i < PERF_COUNTERS; i++) {
+                    tick.counters[i] = perf_done.values[i] - perf_wake.values[i];
+                }
             }
+            tick_log.record(tick);
+            shm_telemetry.publish(tick);
 
             //} else if(true) {
             //    pwm.setSmoothServoAngle(BASE, MS62_SERVO, 135, smoothness);
@@ -321,107 +699,177 @@ int main() {
             //    //pwm.setSmoothServoAngle(FINGER, DM996_SERVO, RS, 2);
             //
             //}
-
-            // Update table
-            screen.PostEvent(ftxui::Event::Custom);
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(50)); // 0.05 sec
         } // End of loop
     });
 
-    // TUI rendering setup
-    auto renderer = Renderer([&] {
-        // Table 1 for all values
-        std::vector<std::vector<std::string>> data = {
-            {"Name",  "Value",                "Delta"},
-            {"x",     std::to_string(x),      std::to_string(x_delta)},
-            {"y",     std::to_string(y),      std::to_string(y_delta)},
-            {"z",     std::to_string(z),      std::to_string(z_delta)},
-            {"roll",  std::to_string(roll),   std::to_string(roll_delta)},
-            {"pitch", std::to_string(pitch),  std::to_string(pitch_delta)},
-            {"yaw",   std::to_string(yaw),    std::to_string(yaw_delta)}
-        };
-
-        // Build the visual table element
-        auto t1 = Table(data);
-
-        // Apply visual styles to look like a clean data dashboard
-        t1.SelectRow(0).Decorate(bold | color(Color::Cyan));    // Header row styling
-        t1.SelectColumn(0).Decorate(color(Color::Yellow));      // Leftmost name column styling
-        t1.SelectAll().Border(ftxui::LIGHT);                    // Outer border around the table edges
-        t1.SelectAll().Separator(ftxui::LIGHT);                 // Adds both vertical and horizontal inner dividers
-
-
-
-        // Table 2 for all motor values
-        std::vector<std::vector<std::string>> angles = {
-            {"Servo",       "Angle"},
-            {"MS62_1",      std::to_string(angle0)},
-            {"MS62_2",      std::to_string(angle1)},
-            {"DM996_1",     std::to_string(angle2)},
-            {"DM996_2",     std::to_string(angle3)},
-            {"DM996_3",     std::to_string(angle4)},
-            {"DM996_4",     std::to_string(angle5)}
-        };
-
-        // Build the visual table element
-        auto t2 = Table(angles);
-
-        // Apply visual styles to look like a clean data dashboard
-        t2.SelectRow(0).Decorate(bold | color(Color::Cyan));    // Header row styling
-        t2.SelectColumn(0).Decorate(color(Color::Yellow));      // Leftmost name column styling
-        t2.SelectAll().Border(ftxui::LIGHT);                    // Outer border around the table edges
-        t2.SelectAll().Separator(ftxui::LIGHT);                 // Adds both vertical and horizontal inner dividers
-
-        
-
-
-        // ==========================================
-        // 3. LAYOUT ARRAIGNMENT
-        // ==========================================
-        auto text_box = text("Add IK solution here eventually.");
-        
-        return vbox({
-            hbox({
-                t1.Render(),
-                ftxui::separator(),
-                t2.Render()
-            }) | center,
-            text_box | center
-        });
+    const StatusSources sources{&telemetry, &pwm, &output, &input_loop, &ik_loop, &pose_age, &ik_solve, &ik_tick_perf, &ring};
+
+    // Status out to --ui processes and operator commands back, at normal priority
+    PeriodicLoop link_loop(UI_RATE_HZ);
+    std::thread link_thread([&]() {
+        TRACE_THREAD("link");
+        ControlStatus status{};
+        ControlCommand command;
+        while (g_running && link.isOpen()) {
+            link_loop.next();
+            collectStatus(sources, status);
+            link.publish(status);
+
+            while (link.receive(command)) {
+                switch (command.type) {
+                case ControlCommandType::EmergencyStop:
+                    pwm.emergencyStop();
+                    g_running = 0;
+                    break;
+                case ControlCommandType::Shutdown:
+                    g_running = 0;
+                    break;
+                case ControlCommandType::TraceCapture:
+#ifdef ENABLE_TRACING
+                    TraceCapture::request();
+#endif
+                    break;
+                }
+            }
+        }
     });
 
+    Dashboard dashboard;
+    ControlStatus status{};
+    PeriodicLoop ui_loop(UI_RATE_HZ);
 
-    // 3. Blocks this thread, rendering the UI smoothly
-    screen.Loop(renderer); 
+    if (headless) {
+        // Compact stats to stdout, the journal when running under systemd
+        std::cout << "Running headless, stats every " << STATS_INTERVAL_S << " s" << std::endl;
+        char line[256];
+        auto next_stats = std::chrono::steady_clock::now() + std::chrono::seconds(STATS_INTERVAL_S);
+        while (g_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (std::chrono::steady_clock::now() >= next_stats) {
+                next_stats += std::chrono::seconds(STATS_INTERVAL_S);
+                collectStatus(sources, status);
+                const size_t len = dashboard.summary(status, line, sizeof(line));
+                std::cout.write(line, len) << std::endl;
+            }
+        }
+    } else {
+        // TUI rendering setup: the dashboard refreshes at its own rate, however fast the control loops run.
+        // The terminal is only taken over here, never in headless mode
+        auto screen = ScreenInteractive::TerminalOutput();
+        auto renderer = Renderer([&] {
+            TRACE_SCOPE("render");
+            collectStatus(sources, status);
+            dashboard.refresh(status);
+            return dashboard.render();
+        });
+
+        std::thread ui_thread([&]() {
+            TRACE_THREAD("ui");
+            while (g_running) {
+                ui_loop.next();
+                TRACE_SCOPE("PostEvent");
+                screen.PostEvent(ftxui::Event::Custom);
+            }
+            screen.ExitLoopClosure()();
+        });
+
+        // Blocks this thread, rendering the UI smoothly
+        screen.Loop(renderer);
+
+        // It posts to the screen, which ends with this scope
+        ui_thread.join();
+    }
+
+    // Everything below is bounded: homing has its own time limit, the watchdog covers a hung bus
+    ::signal(SIGALRM, shutdown_watchdog);
+    alarm(SHUTDOWN_TIMEOUT_S);
 
 
     // Clean-up & close TUI properly
     //refresh_ui = false;
+    if (input_thread.joinable()) {
+        input_thread.join();
+    }
     if (ik_thread.joinable()) {
         ik_thread.join();
     }
+    if (link_thread.joinable()) {
+        link_thread.join();
+    }
 
-    for(int i = 0; i < 50; i++) {
-        
-        pwm.setSmoothServoAngle(BASE, MS62_SERVO, 135, 2);
-        usleep(20);
-        pwm.setSmoothServoAngle(SHOULDER, MS62_SERVO_A, 141, 2);
-        usleep(20);
-        pwm.setSmoothServoAngle(UPPER_ARM, DM996_SERVO, 60, 2);
-        usleep(20);
-        pwm.setSmoothServoAngle(FOREARM, DM996_SERVO, 90, 2);
-        usleep(20);
-        pwm.setSmoothServoAngle(WIRST, DM996_SERVO, 90, 2);
-        usleep(20);
-        pwm.setSmoothServoAngle(FINGER, DM996_SERVO, 90, 2);
-        usleep(100000);
+    output.stop();
+    pwm.flush();
+    tick_log.stop();
+#ifdef ENABLE_TRACING
+    trace_capture.stop();
+#endif
+    std::cout << "IK loop: " << ik_loop.ticks() << " ticks at " << ik_loop.rate() << " Hz, overruns: " << ik_loop.overruns()
+              << ", lateness p99: " << ik_loop.lateness().percentile(99).count()
+              << " us, compute p99: " << ik_loop.compute().percentile(99).count() << " us" << std::endl;
+    std::cout << "Input loop: " << input_loop.ticks() << " ticks at " << input_loop.rate() << " Hz, overruns: " << input_loop.overruns()
+              << ". Input -> IK p99: " << pose_age.percentile(99).count()
+              << " us, input -> servo frame p99: " << output.targetAge().percentile(99).count() << " us" << std::endl;
+    if (tick_log.recorded() > 0) {
+        std::cout << "Tick log: " << tick_log.written() << " records written to " << TICK_LOG_FILE
+                  << ", dropped: " << tick_log.dropped() << std::endl;
     }
+    const std::pair<const char *, const PerfStage *> perf_stages[] = {
+        {"tick", &ik_tick_perf}, {"solve", &ik_solve_perf}, {"post", &ik_post_perf}};
+    for (const auto &[stage, perf] : perf_stages) {
+        if (perf->count() == 0) {
+            continue;
+        }
+        std::cout << "IK " << stage << " per tick:";
+        for (size_t i = 0; i < PERF_COUNTERS; i++) {
+            std::cout << (i ? ", " : " ") << PerfCounters::name(static_cast<PerfCounter>(i)) << " "
+                      << std::fixed << std::setprecision(1) << perf->perCall(static_cast<PerfCounter>(i));
+        }
+        std::cout << ", IPC " << std::setprecision(2) << perf->ipc() << std::defaultfloat << std::endl;
+    }
+    std::cout << "Output frames: " << output.frames() << ", missed: " << output.missedFrames()
+              << ", failed: " << output.failedUpdates() << std::endl;
 
-    // Program stopping
-    for (int i = 0; i < 16; i++) {
-        pwm.setPWM(i, 0, 4096);   // Turn off channel (full-off via 4096)
+    BusStats bus = pwm.getBusStats();
+    std::cout << "I2C transactions: " << bus.transactions << ", errors: " << bus.errors << ", retries: " << bus.retries
+              << ", failures: " << bus.failures << ", latency p99: " << pwm.busLatency().percentile(99).count() << " us" << std::endl;
+
+    if (ring.available()) {
+        UringStats async = ring.getStats();
+        std::cout << "io_uring writes: " << async.writes << " in " << async.submits << " submits, failed: " << async.failed
+                  << ", cancelled: " << async.cancelled << ", skipped (fd busy): " << async.skipped << std::endl;
+    }
+
+    OutputStats writes = pwm.getOutputStats();
+    std::cout << "Channel updates: " << writes.updates + writes.hysteresisSkips
+              << ", suppressed by hysteresis: " << writes.hysteresisSkips
+              << ", by register shadow: " << writes.shadowSkips
+              << ", written: " << writes.channelWrites << " in " << writes.busWrites << " bus writes" << std::endl;
+
+    if (pwm.emergencyStopped()) {
+        std::cout << "Emergency stop: outputs off " << estop_latency_ms << " ms after button press";
+        if (estop_write_us >= 0) {
+            std::cout << " (ALL_LED write " << estop_write_us << " us)";
+        }
+        std::cout << "." << std::endl;
+    } else if (hold) {
+        // Outputs keep running, the next start adopts them
+        jointState.flush();
+        std::cout << "Holding position. Goodbye." << std::endl;
+        return 0;
+    } else {
+        // Home all joints together, bounded to 1.5 s
+        pwm.homeServos(home, sizeof(home) / sizeof(home[0]), std::chrono::milliseconds(1500));
+
+        uint16_t homeMask = 0;
+        for (const ServoTarget &joint : home) {
+            homeMask |= (1u << joint.channel);
+        }
+        jointState.store(pwm.profiler().positions(), homeMask);
     }
+    jointState.flush();
+
+    // Program stopping
+    pwm.allOff();                // Turn off all channels in one ALL_LED write
 
     pwm.sleep();                 // Put PCA9685 to sleep to stop all outputs
     std::cout << "Goodbye." << std::endl;